@@ -30,7 +30,10 @@
 //
 // 	Our implementation at this point has the following restrictions:
 //
-//	   there is no synchronization for concurrent accesses
+//	   concurrent accesses are synchronized only at the level of the
+//	     directory and bitmap: lookups share a readers-writer lock,
+//	     and Create and Remove hold it exclusively; nothing protects
+//	     the contents of a file from concurrent reads and writes
 //	   files have a fixed size, set when the file is created
 //	   files cannot be bigger than about 3KB in size
 //	   there is no hierarchical directory structure, and only a limited
@@ -50,6 +53,7 @@
 #include "directory.h"
 #include "filehdr.h"
 #include "filesys.h"
+#include "synch.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
 // and the directory of files.  These file headers are placed in well-known 
@@ -80,6 +84,7 @@
 FileSystem::FileSystem(bool format)
 { 
     DEBUG('f', "Initializing the file system.\n");
+    directoryLock = new RWLock("directory", PreferWriters);
     if (format) {
         BitMap *freeMap = new BitMap(NumSectors);
         Directory *directory = new Directory(NumDirEntries);
@@ -164,8 +169,9 @@ FileSystem::FileSystem(bool format)
 //	 	no free entry for file in directory
 //	 	no free space for data blocks for the file 
 //
-// 	Note that this implementation assumes there is no concurrent access
-//	to the file system!
+// 	The directory and bitmap are read, changed, and written back
+//	while holding the directory lock for writing, so that concurrent
+//	Creates and Removes don't overwrite each other's changes.
 //
 //	"name" -- name of file to be created
 //	"initialSize" -- size of file to be created
@@ -182,6 +188,7 @@ FileSystem::Create(const char *name, int initialSize)
 
     DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
 
+    directoryLock->AcquireWrite();
     directory = new Directory(NumDirEntries);
     directory->FetchFrom(directoryFile);
 
@@ -210,6 +217,7 @@ FileSystem::Create(const char *name, int initialSize)
 	}
         delete freeMap;
     }
+    directoryLock->ReleaseWrite();
     delete directory;
     return success;
 }
@@ -221,6 +229,8 @@ FileSystem::Create(const char *name, int initialSize)
 //	  Find the location of the file's header, using the directory 
 //	  Bring the header into memory
 //
+//	Any number of threads may be looking up names at once.
+//
 //	"name" -- the text name of the file to be opened
 //----------------------------------------------------------------------
 
@@ -232,10 +242,12 @@ FileSystem::Open(const char *name)
     int sector;
 
     DEBUG('f', "Opening file %s\n", name);
+    directoryLock->AcquireRead();
     directory->FetchFrom(directoryFile);
     sector = directory->Find(name); 
     if (sector >= 0) 		
 	openFile = new OpenFile(sector);	// name was found in directory 
+    directoryLock->ReleaseRead();
     delete directory;
     return openFile;				// return NULL if not found
 }
@@ -262,10 +274,12 @@ FileSystem::Remove(const char *name)
     FileHeader *fileHdr;
     int sector;
     
+    directoryLock->AcquireWrite();
     directory = new Directory(NumDirEntries);
     directory->FetchFrom(directoryFile);
     sector = directory->Find(name);
     if (sector == -1) {
+       directoryLock->ReleaseWrite();
        delete directory;
        return FALSE;			 // file not found 
     }
@@ -281,6 +295,7 @@ FileSystem::Remove(const char *name)
 
     freeMap->WriteBack(freeMapFile);		// flush to disk
     directory->WriteBack(directoryFile);        // flush to disk
+    directoryLock->ReleaseWrite();
     delete fileHdr;
     delete directory;
     delete freeMap;
@@ -297,7 +312,9 @@ FileSystem::List()
 {
     Directory *directory = new Directory(NumDirEntries);
 
+    directoryLock->AcquireRead();
     directory->FetchFrom(directoryFile);
+    directoryLock->ReleaseRead();
     directory->List();
     delete directory;
 }
@@ -320,6 +337,7 @@ FileSystem::Print()
     BitMap *freeMap = new BitMap(NumSectors);
     Directory *directory = new Directory(NumDirEntries);
 
+    directoryLock->AcquireRead();
     printf("Bit map file header:\n");
     bitHdr->FetchFrom(FreeMapSector);
     bitHdr->Print();
@@ -333,6 +351,7 @@ FileSystem::Print()
 
     directory->FetchFrom(directoryFile);
     directory->Print();
+    directoryLock->ReleaseRead();
 
     delete bitHdr;
     delete dirHdr;
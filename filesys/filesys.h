@@ -65,6 +65,8 @@ class FileSystem {
 };
 
 #else // FILESYS
+class RWLock;
+
 class FileSystem {
   public:
     FileSystem(bool format);		// Initialize the file system.
@@ -90,6 +92,10 @@ class FileSystem {
 					// represented as a file
    OpenFile* directoryFile;		// "Root" directory -- list of 
 					// file names, represented as a file
+   RWLock* directoryLock;		// Held for reading while looking
+					// things up in the directory, and
+					// for writing while changing the
+					// directory or the bitmap
 };
 
 #endif // FILESYS
@@ -69,6 +69,7 @@ class OpenFile {
 
     void Seek(int position); 		// Set the position from which to 
 					// start reading/writing -- UNIX lseek
+    int Tell() { return seekPosition; }	// Return that position
 
     int Read(const char *into, int numBytes); // Read/write bytes from the file,
 					// starting at the implicit position.
@@ -0,0 +1,483 @@
+// blockcache.cc
+//	Routines to translate user code into basic blocks of threaded
+//	code, and to run them.
+//
+//	The common instructions get a handler of their own below; anything
+//	else is handed back to Machine::ExecuteInstruction, so every
+//	instruction behaves exactly as it does in the interpreter.
+//
+//	Simulated time is kept exact by never running a block past the
+//	point where the next interrupt is due: the ticks for the
+//	instructions before that point are simply added up, and the last
+//	instruction in the batch (or one that traps to the kernel) goes
+//	through the usual Interrupt::OneTick.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "machine.h"
+#include "mipssim.h"
+#include "blockcache.h"
+#include "system.h"
+
+//----------------------------------------------------------------------
+// TranslatedBlock::TranslatedBlock
+// 	Make a block out of a run of translated instructions.
+//
+//	"instrs" -- the translated instructions (copied)
+//	"count" -- how many of them there are
+//----------------------------------------------------------------------
+
+TranslatedBlock::TranslatedBlock(TranslatedInstr *instrs, int count)
+{
+    numInstrs = count;
+    code = new TranslatedInstr[count];
+    for (int i = 0; i < count; i++)
+	code[i] = instrs[i];
+    valid = TRUE;
+}
+
+TranslatedBlock::~TranslatedBlock()
+{
+    delete [] code;
+}
+
+//----------------------------------------------------------------------
+// Retire
+// 	Finish an instruction the way ExecuteInstruction does: do any
+//	delayed load, and advance the program counters.
+//----------------------------------------------------------------------
+
+static inline bool
+Retire(Machine *m, int nextLoadReg, int nextLoadValue, int pcAfter)
+{
+    m->DelayedLoad(nextLoadReg, nextLoadValue);
+    m->registers[PrevPCReg] = m->registers[PCReg];
+    m->registers[PCReg] = m->registers[NextPCReg];
+    m->registers[NextPCReg] = pcAfter;
+    return TRUE;
+}
+
+#define REG(r)		(m->registers[ti->r])
+#define SEQUENTIAL	(m->registers[NextPCReg] + 4)
+
+//----------------------------------------------------------------------
+// Instruction handlers
+//	One per common opcode.  Each mirrors the corresponding case in
+//	Machine::ExecuteInstruction.
+//----------------------------------------------------------------------
+
+static bool
+DoGeneric(Machine *m, TranslatedInstr *ti)
+{
+    return m->ExecuteInstruction(ti->instr);
+}
+
+static bool
+DoADDIU(Machine *m, TranslatedInstr *ti)
+{
+    REG(rt) = REG(rs) + ti->extra;
+    return Retire(m, 0, 0, SEQUENTIAL);
+}
+
+static bool
+DoADDU(Machine *m, TranslatedInstr *ti)
+{
+    REG(rd) = REG(rs) + REG(rt);
+    return Retire(m, 0, 0, SEQUENTIAL);
+}
+
+static bool
+DoSUBU(Machine *m, TranslatedInstr *ti)
+{
+    REG(rd) = REG(rs) - REG(rt);
+    return Retire(m, 0, 0, SEQUENTIAL);
+}
+
+static bool
+DoAND(Machine *m, TranslatedInstr *ti)
+{
+    REG(rd) = REG(rs) & REG(rt);
+    return Retire(m, 0, 0, SEQUENTIAL);
+}
+
+static bool
+DoXOR(Machine *m, TranslatedInstr *ti)
+{
+    REG(rd) = REG(rs) ^ REG(rt);
+    return Retire(m, 0, 0, SEQUENTIAL);
+}
+
+static bool
+DoNOR(Machine *m, TranslatedInstr *ti)
+{
+    REG(rd) = ~(REG(rs) | REG(rt));
+    return Retire(m, 0, 0, SEQUENTIAL);
+}
+
+static bool
+DoANDI(Machine *m, TranslatedInstr *ti)
+{
+    REG(rt) = REG(rs) & ti->extra;		// already masked to 16 bits
+    return Retire(m, 0, 0, SEQUENTIAL);
+}
+
+static bool
+DoORI(Machine *m, TranslatedInstr *ti)
+{
+    REG(rt) = REG(rs) | ti->extra;		// already masked to 16 bits
+    return Retire(m, 0, 0, SEQUENTIAL);
+}
+
+static bool
+DoXORI(Machine *m, TranslatedInstr *ti)
+{
+    REG(rt) = REG(rs) ^ ti->extra;		// already masked to 16 bits
+    return Retire(m, 0, 0, SEQUENTIAL);
+}
+
+static bool
+DoLUI(Machine *m, TranslatedInstr *ti)
+{
+    REG(rt) = ti->extra;			// already shifted
+    return Retire(m, 0, 0, SEQUENTIAL);
+}
+
+static bool
+DoSLL(Machine *m, TranslatedInstr *ti)
+{
+    REG(rd) = REG(rt) << ti->extra;
+    return Retire(m, 0, 0, SEQUENTIAL);
+}
+
+static bool
+DoSRA(Machine *m, TranslatedInstr *ti)
+{
+    REG(rd) = REG(rt) >> ti->extra;
+    return Retire(m, 0, 0, SEQUENTIAL);
+}
+
+static bool
+DoSRL(Machine *m, TranslatedInstr *ti)
+{
+    int tmp = REG(rt);
+
+    tmp >>= ti->extra;
+    REG(rd) = tmp;
+    return Retire(m, 0, 0, SEQUENTIAL);
+}
+
+static bool
+DoSLT(Machine *m, TranslatedInstr *ti)
+{
+    REG(rd) = (REG(rs) < REG(rt)) ? 1 : 0;
+    return Retire(m, 0, 0, SEQUENTIAL);
+}
+
+static bool
+DoSLTI(Machine *m, TranslatedInstr *ti)
+{
+    REG(rt) = (REG(rs) < ti->extra) ? 1 : 0;
+    return Retire(m, 0, 0, SEQUENTIAL);
+}
+
+static bool
+DoMFHI(Machine *m, TranslatedInstr *ti)
+{
+    REG(rd) = m->registers[HiReg];
+    return Retire(m, 0, 0, SEQUENTIAL);
+}
+
+static bool
+DoMFLO(Machine *m, TranslatedInstr *ti)
+{
+    REG(rd) = m->registers[LoReg];
+    return Retire(m, 0, 0, SEQUENTIAL);
+}
+
+static bool
+DoLW(Machine *m, TranslatedInstr *ti)
+{
+    int addr = REG(rs) + ti->extra;
+    int value;
+
+    if (addr & 0x3) {
+	m->RaiseException(AddressErrorException, addr);
+	return FALSE;
+    }
+    if (!m->ReadMem(addr, 4, &value))
+	return FALSE;
+    return Retire(m, ti->rt, value, SEQUENTIAL);
+}
+
+static bool
+DoLB(Machine *m, TranslatedInstr *ti)
+{
+    int value;
+
+    if (!m->ReadMem(REG(rs) + ti->extra, 1, &value))
+	return FALSE;
+    if (value & 0x80)
+	value |= 0xffffff00;
+    else
+	value &= 0xff;
+    return Retire(m, ti->rt, value, SEQUENTIAL);
+}
+
+static bool
+DoLBU(Machine *m, TranslatedInstr *ti)
+{
+    int value;
+
+    if (!m->ReadMem(REG(rs) + ti->extra, 1, &value))
+	return FALSE;
+    return Retire(m, ti->rt, value & 0xff, SEQUENTIAL);
+}
+
+static bool
+DoSW(Machine *m, TranslatedInstr *ti)
+{
+    if (!m->WriteMem((unsigned) (REG(rs) + ti->extra), 4, REG(rt)))
+	return FALSE;
+    return Retire(m, 0, 0, SEQUENTIAL);
+}
+
+static bool
+DoSB(Machine *m, TranslatedInstr *ti)
+{
+    if (!m->WriteMem((unsigned) (REG(rs) + ti->extra), 1, REG(rt)))
+	return FALSE;
+    return Retire(m, 0, 0, SEQUENTIAL);
+}
+
+static bool
+DoBEQ(Machine *m, TranslatedInstr *ti)
+{
+    if (REG(rs) == REG(rt))
+	return Retire(m, 0, 0, m->registers[NextPCReg] + ti->extra);
+    return Retire(m, 0, 0, SEQUENTIAL);
+}
+
+static bool
+DoBNE(Machine *m, TranslatedInstr *ti)
+{
+    if (REG(rs) != REG(rt))
+	return Retire(m, 0, 0, m->registers[NextPCReg] + ti->extra);
+    return Retire(m, 0, 0, SEQUENTIAL);
+}
+
+static bool
+DoJ(Machine *m, TranslatedInstr *ti)
+{
+    return Retire(m, 0, 0, (SEQUENTIAL & 0xf0000000) | ti->extra);
+}
+
+static bool
+DoJAL(Machine *m, TranslatedInstr *ti)
+{
+    m->registers[R31] = m->registers[NextPCReg] + 4;
+    return Retire(m, 0, 0, (SEQUENTIAL & 0xf0000000) | ti->extra);
+}
+
+static bool
+DoJR(Machine *m, TranslatedInstr *ti)
+{
+    return Retire(m, 0, 0, REG(rs));
+}
+
+static bool
+DoJALR(Machine *m, TranslatedInstr *ti)
+{
+    REG(rd) = m->registers[NextPCReg] + 4;
+    return Retire(m, 0, 0, REG(rs));
+}
+
+//----------------------------------------------------------------------
+// IsBranch, EndsBlock
+// 	Classify opcodes for block formation.  A branch or jump ends its
+//	block after its delay slot; a system call or illegal instruction
+//	ends it right away, since it always traps to the kernel.
+//----------------------------------------------------------------------
+
+static bool
+IsBranch(int opCode)
+{
+    switch (opCode) {
+      case OP_BEQ: case OP_BNE: case OP_BGEZ: case OP_BGEZAL:
+      case OP_BGTZ: case OP_BLEZ: case OP_BLTZ: case OP_BLTZAL:
+      case OP_J: case OP_JAL: case OP_JALR: case OP_JR:
+	return TRUE;
+      default:
+	return FALSE;
+    }
+}
+
+static bool
+EndsBlock(int opCode)
+{
+    return (opCode == OP_SYSCALL) || (opCode == OP_RES)
+				|| (opCode == OP_UNIMP);
+}
+
+//----------------------------------------------------------------------
+// TranslateInstruction
+// 	Pick the handler for a decoded instruction, and pre-compute its
+//	operands.
+//----------------------------------------------------------------------
+
+static void
+TranslateInstruction(Instruction *instr, TranslatedInstr *ti)
+{
+    ti->rs = instr->rs;
+    ti->rt = instr->rt;
+    ti->rd = instr->rd;
+    ti->extra = instr->extra;
+    ti->instr = instr;
+
+    switch (instr->opCode) {
+      case OP_ADDIU:	ti->handler = DoADDIU; break;
+      case OP_ADDU:	ti->handler = DoADDU; break;
+      case OP_SUBU:	ti->handler = DoSUBU; break;
+      case OP_AND:	ti->handler = DoAND; break;
+      case OP_XOR:	ti->handler = DoXOR; break;
+      case OP_NOR:	ti->handler = DoNOR; break;
+      case OP_SLL:	ti->handler = DoSLL; break;
+      case OP_SRA:	ti->handler = DoSRA; break;
+      case OP_SRL:	ti->handler = DoSRL; break;
+      case OP_SLT:	ti->handler = DoSLT; break;
+      case OP_SLTI:	ti->handler = DoSLTI; break;
+      case OP_MFHI:	ti->handler = DoMFHI; break;
+      case OP_MFLO:	ti->handler = DoMFLO; break;
+      case OP_LW:	ti->handler = DoLW; break;
+      case OP_LB:	ti->handler = DoLB; break;
+      case OP_LBU:	ti->handler = DoLBU; break;
+      case OP_SW:	ti->handler = DoSW; break;
+      case OP_SB:	ti->handler = DoSB; break;
+      case OP_JR:	ti->handler = DoJR; break;
+      case OP_JALR:	ti->handler = DoJALR; break;
+      case OP_ANDI:
+	ti->handler = DoANDI;
+	ti->extra = instr->extra & 0xffff;
+	break;
+      case OP_ORI:
+	ti->handler = DoORI;
+	ti->extra = instr->extra & 0xffff;
+	break;
+      case OP_XORI:
+	ti->handler = DoXORI;
+	ti->extra = instr->extra & 0xffff;
+	break;
+      case OP_LUI:
+	ti->handler = DoLUI;
+	ti->extra = instr->extra << 16;
+	break;
+      case OP_BEQ:
+	ti->handler = DoBEQ;
+	ti->extra = IndexToAddr(instr->extra);
+	break;
+      case OP_BNE:
+	ti->handler = DoBNE;
+	ti->extra = IndexToAddr(instr->extra);
+	break;
+      case OP_J:
+	ti->handler = DoJ;
+	ti->extra = IndexToAddr(instr->extra);
+	break;
+      case OP_JAL:
+	ti->handler = DoJAL;
+	ti->extra = IndexToAddr(instr->extra);
+	break;
+      default:				// uncommon, or may overflow
+	ti->handler = DoGeneric;
+	break;
+    }
+}
+
+//----------------------------------------------------------------------
+// Machine::TranslateBlock
+// 	Translate the basic block starting at a physical address.
+//
+//	The block stops at the end of the page, after a system call, or
+//	after the delay slot of the first branch.  A branch sitting in a
+//	delay slot is left for the interpreter.
+//
+//	"physAddr" -- word-aligned offset into mainMemory
+//----------------------------------------------------------------------
+
+TranslatedBlock *
+Machine::TranslateBlock(int physAddr)
+{
+    TranslatedInstr code[PageSize / 4];
+    int pageEnd = (physAddr / PageSize + 1) * PageSize;
+    int count = 0;
+    bool inDelaySlot = FALSE;
+
+    for (int addr = physAddr; addr < pageEnd; addr += 4) {
+	Instruction *instr = DecodeAt(addr);
+
+	if (inDelaySlot && (IsBranch(instr->opCode)
+				|| EndsBlock(instr->opCode)))
+	    break;
+	TranslateInstruction(instr, &code[count++]);
+	if (inDelaySlot || EndsBlock(instr->opCode))
+	    break;
+	inDelaySlot = IsBranch(instr->opCode);
+    }
+    return new TranslatedBlock(code, count);
+}
+
+//----------------------------------------------------------------------
+// Machine::RunBlock
+// 	Run the translated block at the current PC, translating it first
+//	if need be.  Falls back on the interpreter for a single
+//	instruction when the PC can't start a block: when we are in a
+//	delay slot (so the next PC isn't PC + 4), or the fetch would fault.
+//
+//	The block is cut short so that it ends exactly where the
+//	interpreter would take the next interrupt.  Until then, ticks are
+//	added up without checking for interrupts, since none can be due.
+//----------------------------------------------------------------------
+
+void
+Machine::RunBlock()
+{
+    TranslatedBlock *block;
+    int physicalAddress, slot, limit, i;
+
+    if ((registers[NextPCReg] != registers[PCReg] + 4)
+	    || (Translate(registers[PCReg], &physicalAddress, 4, FALSE)
+							!= NoException)) {
+	OneInstruction();
+	interrupt->OneTick();
+	return;
+    }
+    slot = physicalAddress / 4;
+    if ((block = blockCache[slot]) == NULL)
+	block = blockCache[slot] = TranslateBlock(physicalAddress);
+
+    limit = interrupt->TicksToNextInterrupt() / UserTick;
+    if (limit < 1)
+	limit = 1;
+    if (limit > block->numInstrs)
+	limit = block->numInstrs;
+
+    runningBlock = block;
+    for (i = 0; i < limit; i++) {
+	if (!(*block->code[i].handler)(this, &block->code[i])) {
+	    interrupt->OneTick();	// RaiseException let go of the
+	    return;			// block; it may be gone by now
+	}
+	if (!block->valid)		// the block overwrote its own page
+	    break;
+	if (i < limit - 1) {
+	    stats->totalTicks += UserTick;
+	    stats->userTicks += UserTick;
+	}
+    }
+    runningBlock = NULL;
+    if (!block->valid)
+	delete block;
+    interrupt->OneTick();
+}
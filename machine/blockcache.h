@@ -0,0 +1,61 @@
+// blockcache.h
+//	Data structures for running user programs as translated basic
+//	blocks ("threaded code"), rather than one instruction at a time.
+//
+//	A basic block is a run of instructions within one physical page,
+//	ending after a branch or jump (and its delay slot), a system call,
+//	or the end of the page.  Each instruction in a block is translated
+//	into a pointer to a small handler routine, with its operands already
+//	pulled out of the instruction word, so that running a block is just
+//	a loop of indirect calls -- no fetch, no decode, no big switch.
+//
+//	Blocks are cached by the physical address of their first
+//	instruction, and are thrown away along with the decode cache
+//	whenever their page is written (see Machine::InvalidateCode).
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+
+#include "copyright.h"
+#include "machine.h"
+
+class TranslatedInstr;
+
+// A handler executes one translated instruction, including the delayed
+// load and program counter bookkeeping.  It returns FALSE if the
+// instruction raised an exception.
+typedef bool (*InstrHandler)(Machine *m, TranslatedInstr *ti);
+
+// The following class defines one instruction of a translated block.
+
+class TranslatedInstr {
+  public:
+    InstrHandler handler;	// routine that executes the instruction
+    unsigned int rs, rt, rd;	// register operands
+    unsigned int extra;		// immediate or shift amount, or branch
+				// offset or jump target already
+				// converted to bytes
+    Instruction *instr;		// decoded form, for the instructions that
+				// are simply handed back to the interpreter
+};
+
+// The following class defines a translated basic block.
+
+class TranslatedBlock {
+  public:
+    TranslatedBlock(TranslatedInstr *instrs, int count);
+				// copy "count" translated instructions
+    ~TranslatedBlock();
+
+    TranslatedInstr *code;	// the translated instructions
+    int numInstrs;		// how many of them
+    bool valid;			// FALSE if the block's page was written
+				// while the block was running; the block
+				// is freed once it stops
+};
+
+#endif // BLOCKCACHE_H
@@ -28,7 +28,7 @@
 
 static const char *intLevelNames[] = { "off", "on"};
 static const char *intTypeNames[] = { "timer", "disk", "console write", 
-			"console read", "network send", "network recv"};
+			"console read", "network send", "network recv", "alarm"};
 
 //----------------------------------------------------------------------
 // PendingInterrupt::PendingInterrupt
@@ -48,6 +48,171 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, int param, int time,
     arg = param;
     when = time;
     type = kind;
+    seq = 0;
+    next = NULL;
+}
+
+//----------------------------------------------------------------------
+// InterruptQueue::InterruptQueue
+// 	Initialize an empty queue of pending interrupts.
+//----------------------------------------------------------------------
+
+InterruptQueue::InterruptQueue()
+{
+    maxPending = 16;
+    heap = new PendingInterrupt*[maxPending];
+    numPending = 0;
+    nextSeq = 0;
+    freeList = NULL;
+}
+
+//----------------------------------------------------------------------
+// InterruptQueue::~InterruptQueue
+// 	De-allocate the queue, along with any interrupts still on it.
+//----------------------------------------------------------------------
+
+InterruptQueue::~InterruptQueue()
+{
+    PendingInterrupt *pend;
+
+    for (int i = 0; i < numPending; i++)
+	delete heap[i];
+    while ((pend = freeList) != NULL) {
+	freeList = pend->next;
+	delete pend;
+    }
+    delete [] heap;
+}
+
+//----------------------------------------------------------------------
+// InterruptQueue::Insert
+// 	Put an interrupt on the queue, reusing a free node if there is one.
+//
+//	"func", "param", "time" and "kind" are as for PendingInterrupt.
+//----------------------------------------------------------------------
+
+void
+InterruptQueue::Insert(VoidFunctionPtr func, int param, int time,
+		       IntType kind)
+{
+    PendingInterrupt *pend = freeList;
+
+    if (pend != NULL) {
+	freeList = pend->next;
+	pend->handler = func;
+	pend->arg = param;
+	pend->when = time;
+	pend->type = kind;
+    } else
+	pend = new PendingInterrupt(func, param, time, kind);
+    Reinsert(pend);
+}
+
+//----------------------------------------------------------------------
+// InterruptQueue::Reinsert
+// 	Put an interrupt on the queue, behind any others due at the
+//	same time.
+//----------------------------------------------------------------------
+
+void
+InterruptQueue::Reinsert(PendingInterrupt *pend)
+{
+    if (numPending == maxPending) {		// grow the heap
+	PendingInterrupt **bigger = new PendingInterrupt*[maxPending * 2];
+
+	for (int i = 0; i < numPending; i++)
+	    bigger[i] = heap[i];
+	delete [] heap;
+	heap = bigger;
+	maxPending *= 2;
+    }
+    pend->seq = nextSeq++;
+    pend->next = NULL;
+    heap[numPending] = pend;
+    SiftUp(numPending++);
+}
+
+//----------------------------------------------------------------------
+// InterruptQueue::RemoveFirst
+// 	Take the next interrupt due off the queue.  The caller hands it
+//	back with Free once it is done with it.
+//
+// Returns:
+//	The interrupt, NULL if the queue is empty.
+//----------------------------------------------------------------------
+
+PendingInterrupt *
+InterruptQueue::RemoveFirst()
+{
+    PendingInterrupt *first;
+
+    if (numPending == 0)
+	return NULL;
+    first = heap[0];
+    heap[0] = heap[--numPending];
+    if (numPending > 0)
+	SiftDown(0);
+    return first;
+}
+
+//----------------------------------------------------------------------
+// InterruptQueue::Free
+// 	Recycle an interrupt that has been taken off the queue.
+//----------------------------------------------------------------------
+
+void
+InterruptQueue::Free(PendingInterrupt *pend)
+{
+    pend->next = freeList;
+    freeList = pend;
+}
+
+//----------------------------------------------------------------------
+// InterruptQueue::Mapcar
+// 	Apply a function to each pending interrupt, in heap order
+//	(which is not sorted).  For debugging.
+//----------------------------------------------------------------------
+
+void
+InterruptQueue::Mapcar(VoidFunctionPtr func)
+{
+    for (int i = 0; i < numPending; i++)
+	(*func)((int) heap[i]);
+}
+
+//----------------------------------------------------------------------
+// InterruptQueue::SiftUp, InterruptQueue::SiftDown
+// 	Restore the heap property, by moving the interrupt at index "i"
+//	up towards the root, or down towards the leaves.
+//----------------------------------------------------------------------
+
+void
+InterruptQueue::SiftUp(int i)
+{
+    PendingInterrupt *pend = heap[i];
+
+    while (i > 0 && Before(pend, heap[(i - 1) / 2])) {
+	heap[i] = heap[(i - 1) / 2];
+	i = (i - 1) / 2;
+    }
+    heap[i] = pend;
+}
+
+void
+InterruptQueue::SiftDown(int i)
+{
+    PendingInterrupt *pend = heap[i];
+    int child;
+
+    while ((child = 2 * i + 1) < numPending) {
+	if (child + 1 < numPending && Before(heap[child + 1], heap[child]))
+	    child++;
+	if (!Before(heap[child], pend))
+	    break;
+	heap[i] = heap[child];
+	i = child;
+    }
+    heap[i] = pend;
 }
 
 //----------------------------------------------------------------------
@@ -60,7 +225,7 @@ PendingInterrupt::PendingInterrupt(VoidFunctionPtr func, int param, int time,
 Interrupt::Interrupt()
 {
     level = IntOff;
-    pending = new List();
+    pending = new InterruptQueue();
     inHandler = FALSE;
     yieldOnReturn = FALSE;
     status = SystemMode;
@@ -73,8 +238,6 @@ Interrupt::Interrupt()
 
 Interrupt::~Interrupt()
 {
-    while (!pending->IsEmpty())
-	delete (PendingInterrupt*)(pending->Remove());
     delete pending;
 }
 
@@ -250,7 +413,7 @@ Interrupt::Halt()
 // 	Arrange for the CPU to be interrupted when simulated time
 //	reaches "now + when".
 //
-//	Implementation: just put it on a sorted list.
+//	Implementation: just put it on the pending queue.
 //
 //	NOTE: the Nachos kernel should not call this routine directly.
 //	Instead, it is only called by the hardware device simulators.
@@ -265,13 +428,36 @@ void
 Interrupt::Schedule(VoidFunctionPtr handler, int arg, int fromNow, IntType type)
 {
     int when = stats->totalTicks + fromNow;
-    PendingInterrupt *toOccur = new PendingInterrupt(handler, arg, when, type);
 
     DEBUG('i', "Scheduling interrupt handler the %s at time = %d\n", 
 					intTypeNames[type], when);
     ASSERT(fromNow > 0);
 
-    pending->SortedInsert(toOccur, when);
+    pending->Insert(handler, arg, when, type);
+}
+
+//----------------------------------------------------------------------
+// Interrupt::TicksToNextInterrupt
+// 	Return how much simulated time is left before the next pending
+//	interrupt is due.  No interrupt can fire before then, so the
+//	machine simulation can use this to run several user instructions
+//	before calling OneTick.
+//
+//	Returns 0 if an interrupt is already due, and a very large number
+//	if nothing is pending.
+//----------------------------------------------------------------------
+int
+Interrupt::TicksToNextInterrupt()
+{
+    PendingInterrupt *first = pending->First();
+    int when;
+
+    if (first == NULL)
+	return 0x7fffffff;
+    when = first->when;
+    if (when <= stats->totalTicks)
+	return 0;
+    return when - stats->totalTicks;
 }
 
 //----------------------------------------------------------------------
@@ -297,24 +483,34 @@ Interrupt::CheckIfDue(bool advanceClock)
 					// to invoke an interrupt handler
     if (DebugIsEnabled('i'))
 	DumpState();
-    PendingInterrupt *toOccur = 
-		(PendingInterrupt *)pending->SortedRemove(&when);
+    PendingInterrupt *toOccur = pending->First();
 
     if (toOccur == NULL)		// no pending interrupts
 	return FALSE;			
+    if (!advanceClock && toOccur->when > stats->totalTicks)
+	return FALSE;			// not time yet; leave it be
+    toOccur = pending->RemoveFirst();
+    when = toOccur->when;
+
+// While idle, a timer interrupt can't preempt anyone, so rather than
+// step through them one at a time, put the timer off until the next
+// interrupt that might make a thread ready (an alarm, or I/O).
+    if (advanceClock && (status == IdleMode) && (toOccur->type == TimerInt)
+				&& !pending->IsEmpty()) {
+	int next = pending->First()->when;
+	if (next > when)
+	    toOccur->when = when = next;
+    }
 
-    if (advanceClock && when > stats->totalTicks) {	// advance the clock
+    if (when > stats->totalTicks) {		// advance the clock
 	stats->idleTicks += (when - stats->totalTicks);
 	stats->totalTicks = when;
-    } else if (when > stats->totalTicks) {	// not time yet, put it back
-	pending->SortedInsert(toOccur, when);
-	return FALSE;
     }
 
 // Check if there is nothing more to do, and if so, quit
     if ((status == IdleMode) && (toOccur->type == TimerInt) 
 				&& pending->IsEmpty()) {
-	 pending->SortedInsert(toOccur, when);
+	 pending->Reinsert(toOccur);
 	 return FALSE;
     }
 
@@ -331,7 +527,7 @@ Interrupt::CheckIfDue(bool advanceClock)
     (*(toOccur->handler))(toOccur->arg);	// call the interrupt handler
     status = old;				// restore the machine status
     inHandler = FALSE;
-    delete toOccur;
+    pending->Free(toOccur);
     return TRUE;
 }
 
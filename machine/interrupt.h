@@ -50,7 +50,7 @@ enum MachineStatus {IdleMode, SystemMode, UserMode};
 // In Nachos, we support a hardware timer device, a disk, a console
 // display and keyboard, and a network.
 enum IntType { TimerInt, DiskInt, ConsoleWriteInt, ConsoleReadInt, 
-				NetworkSendInt, NetworkRecvInt};
+				NetworkSendInt, NetworkRecvInt, AlarmInt};
 
 // The following class defines an interrupt that is scheduled
 // to occur in the future.  The internal data structures are
@@ -67,6 +67,51 @@ class PendingInterrupt {
     int arg;                    // The argument to the function.
     int when;			// When the interrupt is supposed to fire
     IntType type;		// for debugging
+    int seq;			// order of scheduling, so that interrupts
+				// due at the same time fire first-come,
+				// first-served
+    PendingInterrupt *next;	// next free node, while on the free list
+};
+
+// The following class defines the queue of interrupts scheduled to
+// occur in the future: a binary min-heap ordered by time, kept in an
+// array that grows as needed.  Insert and RemoveFirst are O(log n),
+// and looking at the next interrupt due is O(1), which matters
+// since that is done on every tick.
+//
+// Nodes are recycled through a free list, rather than going back to
+// the C++ heap each time an interrupt fires.
+
+class InterruptQueue {
+  public:
+    InterruptQueue();			// initialize an empty queue
+    ~InterruptQueue();			// de-allocate the queue and its nodes
+
+    void Insert(VoidFunctionPtr func, int param, int time, IntType kind);
+					// schedule an interrupt
+    void Reinsert(PendingInterrupt *pend); // put back an interrupt taken
+					// off with RemoveFirst
+    PendingInterrupt *First() 		// the next interrupt due, or NULL
+	{ return (numPending == 0) ? NULL : heap[0]; }
+    PendingInterrupt *RemoveFirst();	// take the next interrupt due off
+					// the queue, or return NULL
+    void Free(PendingInterrupt *pend);	// recycle a node from RemoveFirst
+    bool IsEmpty() { return numPending == 0; }
+    void Mapcar(VoidFunctionPtr func);	// apply "func" to every interrupt,
+					// in no particular order
+
+  private:
+    PendingInterrupt **heap;		// heap[0] is the next due
+    int numPending;			// number of interrupts on the heap
+    int maxPending;			// size of the heap array
+    int nextSeq;			// sequence number for the next insert
+    PendingInterrupt *freeList;		// nodes not in use
+
+    bool Before(PendingInterrupt *a, PendingInterrupt *b)
+	{ return (a->when < b->when)
+		|| (a->when == b->when && a->seq < b->seq); }
+    void SiftUp(int i);
+    void SiftDown(int i);
 };
 
 // The following class defines the data structures for the simulation
@@ -111,11 +156,13 @@ class Interrupt {
     					// by the hardware device simulators.
     
     void OneTick();       		// Advance simulated time
+    int TicksToNextInterrupt();		// How long until the next pending
+					// interrupt is due?
 
   private:
     IntStatus level;		// are interrupts enabled or disabled?
-    List *pending;		// the list of interrupts scheduled
-				// to occur in the future
+    InterruptQueue *pending;	// the interrupts scheduled to occur
+				// in the future
     bool inHandler;		// TRUE if we are running an interrupt handler
     bool yieldOnReturn; 	// TRUE if we are to context switch
 				// on return from the interrupt handler
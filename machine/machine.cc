@@ -9,6 +9,7 @@
 
 #include "copyright.h"
 #include "machine.h"
+#include "blockcache.h"
 #include "system.h"
 
 // Textual names of the exceptions that can be generated by user program
@@ -50,9 +51,12 @@ void CheckEndian()
 //
 //	"debug" -- if TRUE, drop into the debugger after each user instruction
 //		is executed.
+//	"blocks" -- if TRUE, run user code as translated basic blocks
+//		(see blockcache.cc)
+//	"tlbEntries" -- the size of the TLB, if USE_TLB is defined
 //----------------------------------------------------------------------
 
-Machine::Machine(bool debug)
+Machine::Machine(bool debug, bool blocks, int tlbEntries)
 {
     int i;
 
@@ -61,12 +65,28 @@ Machine::Machine(bool debug)
     mainMemory = new char[MemorySize];
     for (i = 0; i < MemorySize; i++)
       	mainMemory[i] = 0;
+    decodeCache = new Instruction[MemorySize / 4];
+    decodeValid = new bool[MemorySize / 4];
+    for (i = 0; i < MemorySize / 4; i++)
+	decodeValid[i] = FALSE;
+    codePage = new bool[NumPhysPages];
+    for (i = 0; i < NumPhysPages; i++)
+	codePage[i] = FALSE;
+    blockCache = new TranslatedBlock *[MemorySize / 4];
+    for (i = 0; i < MemorySize / 4; i++)
+	blockCache[i] = NULL;
+    runningBlock = NULL;
+    useBlocks = blocks;
+    FlushTranslationCache();
 #ifdef USE_TLB
-    tlb = new TranslationEntry[TLBSize];
-    for (i = 0; i < TLBSize; i++)
+    ASSERT(tlbEntries > 0);
+    tlbSize = tlbEntries;
+    tlb = new TranslationEntry[tlbSize];
+    for (i = 0; i < tlbSize; i++)
 	tlb[i].valid = FALSE;
     pageTable = NULL;
 #else	// use linear page table
+    tlbSize = 0;
     tlb = NULL;
     pageTable = NULL;
 #endif
@@ -83,6 +103,13 @@ Machine::Machine(bool debug)
 Machine::~Machine()
 {
     delete [] mainMemory;
+    delete [] decodeCache;
+    delete [] decodeValid;
+    delete [] codePage;
+    for (int i = 0; i < MemorySize / 4; i++)
+	if (blockCache[i] != NULL)
+	    delete blockCache[i];
+    delete [] blockCache;
     if (tlb != NULL)
         delete [] tlb;
 }
@@ -93,6 +120,13 @@ Machine::~Machine()
 //	the user program either invoked a system call, or some exception
 //	occured (such as the address translation failed).
 //
+//	If the trap comes from the middle of a translated block, RunBlock
+//	is done with the block: the kernel may switch threads before we
+//	return, or never return at all (Exit, Exec), and then the block's
+//	page may be freed and reused.  So stop treating the block as
+//	running, and free it now if its page has already been written, so
+//	that InvalidateCode will free it, rather than just marking it.
+//
 //	"which" -- the cause of the kernel trap
 //	"badVaddr" -- the virtual address causing the trap, if appropriate
 //----------------------------------------------------------------------
@@ -102,6 +136,11 @@ Machine::RaiseException(ExceptionType which, int badVAddr)
 {
     DEBUG('m', "Exception: %s\n", exceptionNames[which]);
     
+    if (runningBlock != NULL) {
+	if (!runningBlock->valid)
+	    delete runningBlock;
+	runningBlock = NULL;
+    }
 //  ASSERT(interrupt->getStatus() == UserMode);
     registers[BadVAddrReg] = badVAddr;
     DelayedLoad(0, 0);			// finish anything in progress
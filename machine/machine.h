@@ -35,6 +35,9 @@
 #define NumPhysPages    32
 #define MemorySize 	(NumPhysPages * PageSize)
 #define TLBSize		4		// if there is a TLB, make it small
+					// (the default; see Machine::tlbSize)
+#define TranslationCacheSize 32		// entries in the simulator's own
+					// cache of recent translations
 
 enum ExceptionType { NoException,           // Everything ok!
 		     SyscallException,      // A program executed a system call.
@@ -104,10 +107,16 @@ class Instruction {
 // The procedures in this class are defined in machine.cc, mipssim.cc, and
 // translate.cc.
 
+class TranslatedBlock;
+
 class Machine {
   public:
-    Machine(bool debug);	// Initialize the simulation of the hardware
-				// for running user programs
+    Machine(bool debug, bool blocks, int tlbEntries);
+				// Initialize the simulation of the hardware
+				// for running user programs; if "blocks",
+				// run them as translated basic blocks.
+				// The TLB, if any, has "tlbEntries"
+				// entries.
     ~Machine();			// De-allocate the data structures
 
 // Routines callable by the Nachos kernel
@@ -121,8 +130,25 @@ class Machine {
 
 // Routines internal to the machine simulation -- DO NOT call these 
 
-    void OneInstruction(Instruction *instr); 	
-    				// Run one instruction of a user program.
+    void OneInstruction(); 	// Run one instruction of a user program.
+    bool ExecuteInstruction(Instruction *instr);
+				// Execute a decoded instruction.  Return
+				// FALSE if it raised an exception.
+    void RunBlock();		// Run the translated basic block at the PC
+    TranslatedBlock *TranslateBlock(int physAddr);
+				// Translate the basic block starting at
+				// a physical address
+    Instruction *FetchInstruction();
+				// Return the decoded instruction at the PC,
+				// from the decode cache if possible.  Return
+				// NULL if the fetch raised an exception.
+    Instruction *DecodeAt(int physAddr);
+				// Return the decoded instruction at a
+				// physical address
+    void InvalidateCode(int physPage);
+				// Discard any decoded instructions cached
+				// for a physical page, because the page
+				// is about to be (or has been) overwritten
     void DelayedLoad(int nextReg, int nextVal);  	
 				// Do a pending delayed load (modifying a reg)
     
@@ -138,6 +164,10 @@ class Machine {
 				// the translation entry appropriately,
     				// and return an exception code if the 
 				// translation couldn't be completed.
+    void FlushTranslationCache();
+				// Forget all cached translations.  Must be
+				// called whenever the page table or TLB
+				// is switched or changed.
 
     void RaiseException(ExceptionType which, int badVAddr);
 				// Trap to the Nachos kernel, because of a
@@ -178,11 +208,32 @@ class Machine {
 
     TranslationEntry *tlb;		// this pointer should be considered 
 					// "read-only" to Nachos kernel code
+    int tlbSize;			// number of entries in the TLB
 
     TranslationEntry *pageTable;
     unsigned int pageTableSize;
 
   private:
+    Instruction *decodeCache;	// decoded copy of each word of mainMemory
+				// that has been fetched as an instruction
+    bool *decodeValid;		// is the decodeCache entry for a word current?
+    bool *codePage;		// does a physical page have any entries
+				// in the decodeCache?  Writes to such
+				// pages must invalidate them.
+
+    int xlateTag[TranslationCacheSize];	// virtual page cached in each
+				// slot of the translation cache, or -1
+    int xlateBase[TranslationCacheSize]; // its frame's offset in mainMemory
+    bool xlateWritable[TranslationCacheSize]; // has the page been written
+				// through this slot (so dirty is already
+				// set, and the page isn't read-only)?
+
+    bool useBlocks;		// run translated basic blocks, rather than
+				// interpreting one instruction at a time
+    TranslatedBlock **blockCache; // translated block starting at each word
+				// of mainMemory, or NULL
+    TranslatedBlock *runningBlock; // the block now being run, if any
+
     bool singleStep;		// drop back into the debugger after each
 				// simulated instruction
     int runUntilTime;		// drop back into the debugger when simulated
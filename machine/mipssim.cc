@@ -14,6 +14,7 @@
 
 #include "machine.h"
 #include "mipssim.h"
+#include "blockcache.h"
 #include "system.h"
 
 static void Mult(int a, int b, bool signedArith, unsigned int* hiPtr, unsigned int* loPtr);
@@ -25,20 +26,25 @@ static void Mult(int a, int b, bool signedArith, unsigned int* hiPtr, unsigned i
 //
 //	This routine is re-entrant, in that it can be called multiple
 //	times concurrently -- one for each thread executing user code.
+//
+//	Translated blocks are only used when nobody is watching the
+//	individual instructions go by (single stepping, or 'm' tracing).
 //----------------------------------------------------------------------
 
 void
 Machine::Run()
 {
-    Instruction *instr = new Instruction;  // storage for decoded instruction
-
     if(DebugIsEnabled('m'))
         printf("Starting thread \"%s\" at time %d\n",
 	       currentThread->getName(), stats->totalTicks);
     interrupt->setStatus(UserMode);
     for (;;) {
-        OneInstruction(instr);
-	interrupt->OneTick();
+	if (useBlocks && !singleStep && !DebugIsEnabled('m'))
+	    RunBlock();
+	else {
+	    OneInstruction();
+	    interrupt->OneTick();
+	}
 	if (singleStep && (runUntilTime <= stats->totalTicks))
 	  Debugger();
     }
@@ -88,21 +94,21 @@ TypeToReg(RegType reg, Instruction *instr)
 //	leaving.  This allows the Nachos kernel to control our behavior
 //	by controlling the contents of memory, the translation table,
 //	and the register set.
+//
+//	The one exception is the decode cache (see FetchInstruction),
+//	which is keyed by physical address and so stays correct no matter
+//	what the kernel does to the translation table, as long as every
+//	write to a cached code page invalidates it.
 //----------------------------------------------------------------------
 
 void
-Machine::OneInstruction(Instruction *instr)
+Machine::OneInstruction()
 {
-    int raw;
-    int nextLoadReg = 0; 	
-    int nextLoadValue = 0; 	// record delayed load operation, to apply
-				// in the future
+    Instruction *instr;
 
     // Fetch instruction 
-    if (!machine->ReadMem(registers[PCReg], 4, &raw))
+    if ((instr = FetchInstruction()) == NULL)
 	return;			// exception occurred
-    instr->value = raw;
-    instr->Decode();
 
     if (DebugIsEnabled('m')) {
        struct OpString *str = &opStrings[instr->opCode];
@@ -113,6 +119,28 @@ Machine::OneInstruction(Instruction *instr)
 		TypeToReg(str->args[1], instr), TypeToReg(str->args[2], instr));
        printf("\n");
        }
+
+    (void) ExecuteInstruction(instr);
+}
+
+//----------------------------------------------------------------------
+// Machine::ExecuteInstruction
+// 	Execute one decoded instruction, the one at the current PC, and
+//	advance the program counters past it.
+//
+// Returns:
+//	FALSE if the instruction raised an exception (in which case the
+//	kernel has already handled it), TRUE otherwise.
+//
+//	"instr" -- the decoded instruction
+//----------------------------------------------------------------------
+
+bool
+Machine::ExecuteInstruction(Instruction *instr)
+{
+    int nextLoadReg = 0; 	
+    int nextLoadValue = 0; 	// record delayed load operation, to apply
+				// in the future
     
     // Compute next pc, but don't install in case there's an error or branch.
     int pcAfter = registers[NextPCReg] + 4;
@@ -127,7 +155,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (!((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = sum;
 	break;
@@ -137,7 +165,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (!((registers[instr->rs] ^ instr->extra) & SIGN_BIT) &&
 	    ((instr->extra ^ sum) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rt] = sum;
 	break;
@@ -232,7 +260,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_LBU:
 	tmp = registers[instr->rs] + instr->extra;
 	if (!machine->ReadMem(tmp, 1, &value))
-	    return;
+	    return FALSE;
 
 	if ((value & 0x80) && (instr->opCode == OP_LB))
 	    value |= 0xffffff00;
@@ -247,10 +275,10 @@ Machine::OneInstruction(Instruction *instr)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x1) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
 	if (!machine->ReadMem(tmp, 2, &value))
-	    return;
+	    return FALSE;
 
 	if ((value & 0x8000) && (instr->opCode == OP_LH))
 	    value |= 0xffff0000;
@@ -269,10 +297,10 @@ Machine::OneInstruction(Instruction *instr)
 	tmp = registers[instr->rs] + instr->extra;
 	if (tmp & 0x3) {
 	    RaiseException(AddressErrorException, tmp);
-	    return;
+	    return FALSE;
 	}
 	if (!machine->ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 	nextLoadReg = instr->rt;
 	nextLoadValue = value;
 	break;
@@ -286,7 +314,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 	if (registers[LoadReg] == instr->rt)
 	    nextLoadValue = registers[LoadValueReg];
 	else
@@ -317,7 +345,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem(tmp, 4, &value))
-	    return;
+	    return FALSE;
 	if (registers[LoadReg] == instr->rt)
 	    nextLoadValue = registers[LoadValueReg];
 	else
@@ -383,13 +411,13 @@ Machine::OneInstruction(Instruction *instr)
       case OP_SB:
 	if (!machine->WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 1, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SH:
 	if (!machine->WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 2, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SLL:
@@ -459,7 +487,7 @@ Machine::OneInstruction(Instruction *instr)
 	if (((registers[instr->rs] ^ registers[instr->rt]) & SIGN_BIT) &&
 	    ((registers[instr->rs] ^ diff) & SIGN_BIT)) {
 	    RaiseException(OverflowException, 0);
-	    return;
+	    return FALSE;
 	}
 	registers[instr->rd] = diff;
 	break;
@@ -471,7 +499,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_SW:
 	if (!machine->WriteMem((unsigned) 
 		(registers[instr->rs] + instr->extra), 4, registers[instr->rt]))
-	    return;
+	    return FALSE;
 	break;
 	
       case OP_SWL:	  
@@ -482,7 +510,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem((tmp & ~0x3), 4, &value))
-	    return;
+	    return FALSE;
 	switch (tmp & 0x3) {
 	  case 0:
 	    value = registers[instr->rt];
@@ -501,7 +529,7 @@ Machine::OneInstruction(Instruction *instr)
 	    break;
 	}
 	if (!machine->WriteMem((tmp & ~0x3), 4, value))
-	    return;
+	    return FALSE;
 	break;
     	
       case OP_SWR:	  
@@ -512,7 +540,7 @@ Machine::OneInstruction(Instruction *instr)
 	ASSERT((tmp & 0x3) == 0);  
 
 	if (!machine->ReadMem((tmp & ~0x3), 4, &value))
-	    return;
+	    return FALSE;
 	switch (tmp & 0x3) {
 	  case 0:
 	    value = (value & 0xffffff) | (registers[instr->rt] << 24);
@@ -528,12 +556,12 @@ Machine::OneInstruction(Instruction *instr)
 	    break;
 	}
 	if (!machine->WriteMem((tmp & ~0x3), 4, value))
-	    return;
+	    return FALSE;
 	break;
     	
       case OP_SYSCALL:
 	RaiseException(SyscallException, 0);
-	return; 
+	return FALSE; 
 	
       case OP_XOR:
 	registers[instr->rd] = registers[instr->rs] ^ registers[instr->rt];
@@ -546,7 +574,7 @@ Machine::OneInstruction(Instruction *instr)
       case OP_RES:
       case OP_UNIMP:
 	RaiseException(IllegalInstrException, 0);
-	return;
+	return FALSE;
 	
       default:
 	ASSERT(FALSE);
@@ -562,6 +590,90 @@ Machine::OneInstruction(Instruction *instr)
 						// are jumping into lala-land
     registers[PCReg] = registers[NextPCReg];
     registers[NextPCReg] = pcAfter;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Machine::FetchInstruction
+// 	Fetch and decode the instruction at the current PC.
+//
+//	Decoded instructions are cached by physical word address, so
+//	that the body of a loop is only decoded on the first trip through.
+//	A cached entry stays valid until its page is written, either by
+//	the user program (WriteMem) or by the kernel, which must call
+//	InvalidateCode before it reuses or overwrites a frame.
+//
+// Returns:
+//	The decoded instruction, or NULL if the fetch raised an exception.
+//----------------------------------------------------------------------
+
+Instruction *
+Machine::FetchInstruction()
+{
+    ExceptionType exception;
+    int physicalAddress;
+
+    exception = Translate(registers[PCReg], &physicalAddress, 4, FALSE);
+    if (exception != NoException) {
+	RaiseException(exception, registers[PCReg]);
+	return NULL;
+    }
+    return DecodeAt(physicalAddress);
+}
+
+//----------------------------------------------------------------------
+// Machine::DecodeAt
+// 	Return the decoded form of the instruction word at a physical
+//	address, decoding it into the cache if it isn't there already.
+//
+//	"physAddr" -- word-aligned offset into mainMemory
+//----------------------------------------------------------------------
+
+Instruction *
+Machine::DecodeAt(int physAddr)
+{
+    int slot = physAddr / 4;
+    Instruction *instr = &decodeCache[slot];
+
+    if (!decodeValid[slot]) {			// first time we've seen it
+	instr->value = WordToHost(*(unsigned int *) &mainMemory[physAddr]);
+	instr->Decode();
+	decodeValid[slot] = TRUE;
+	codePage[physAddr / PageSize] = TRUE;
+    }
+    return instr;
+}
+
+//----------------------------------------------------------------------
+// Machine::InvalidateCode
+// 	Throw away the decoded instructions and translated blocks cached
+//	for a physical page, because the contents of the page have changed.
+//
+//	The block now being run can't be freed out from under RunBlock;
+//	it is just marked invalid, and RunBlock frees it when it stops
+//	(or RaiseException does, if it stops on a trap).
+//
+//	"physPage" -- the physical page number
+//----------------------------------------------------------------------
+
+void
+Machine::InvalidateCode(int physPage)
+{
+    int first = physPage * (PageSize / 4);
+
+    if (!codePage[physPage])			// nothing was ever decoded
+	return;
+    for (int i = 0; i < PageSize / 4; i++) {
+	decodeValid[first + i] = FALSE;
+	if (blockCache[first + i] != NULL) {
+	    if (blockCache[first + i] == runningBlock)
+		runningBlock->valid = FALSE;
+	    else
+		delete blockCache[first + i];
+	    blockCache[first + i] = NULL;
+	}
+    }
+    codePage[physPage] = FALSE;
 }
 
 //----------------------------------------------------------------------
@@ -21,7 +21,12 @@ Statistics::Statistics()
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
-    numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numPageFaults = numPageEvictions = numPageWritebacks = 0;
+    numTLBHits = numTLBMisses = 0;
+    numContextSwitches = numPreemptions = 0;
+    numRegisterRestoresElided = numSpaceSwitchesElided = 0;
+    numLockHandoffs = numWaitsMorphed = 0;
+    numPacketsSent = numPacketsRecvd = 0;
 }
 
 //----------------------------------------------------------------------
@@ -38,7 +43,19 @@ Statistics::Print()
     printf("Disk I/O: reads %d, writes %d\n", numDiskReads, numDiskWrites);
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead, 
 	numConsoleCharsWritten);
-    printf("Paging: faults %d\n", numPageFaults);
+    printf("Paging: faults %d, evictions %d, writebacks %d\n", numPageFaults,
+	numPageEvictions, numPageWritebacks);
+    printf("Scheduling: context switches %d, preemptions %d\n",
+	numContextSwitches, numPreemptions);
+    printf("Synchronization: lock handoffs %d, waits morphed %d\n",
+	numLockHandoffs, numWaitsMorphed);
+#ifdef USER_PROGRAM
+    printf("Elided on switch: register restores %d, address space loads %d\n",
+	numRegisterRestoresElided, numSpaceSwitchesElided);
+#endif
+#ifdef USE_TLB
+    printf("TLB: hits %d, misses %d\n", numTLBHits, numTLBMisses);
+#endif
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd, 
 	numPacketsSent);
 }
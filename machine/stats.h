@@ -33,6 +33,20 @@ class Statistics {
     int numConsoleCharsRead;	// number of characters read from the keyboard
     int numConsoleCharsWritten; // number of characters written to the display
     int numPageFaults;		// number of virtual memory page faults
+    int numPageEvictions;	// number of pages evicted from memory
+    int numPageWritebacks;	// number of evicted pages written to swap
+    int numTLBHits;		// number of translations found in the TLB
+    int numTLBMisses;		// number of translations not in the TLB
+    int numContextSwitches;	// number of times the CPU changed threads
+    int numPreemptions;		// number of times the timer took the CPU
+				// away from a running thread
+    int numRegisterRestoresElided; // context switches back to the user
+				// program whose registers were still loaded
+    int numSpaceSwitchesElided;	// context switches to the address space
+				// the machine was already using
+    int numLockHandoffs;	// locks passed straight to a waiter
+    int numWaitsMorphed;	// condition waiters moved to a lock's
+				// queue instead of the ready list
     int numPacketsSent;		// number of packets sent over the network
     int numPacketsRecvd;	// number of packets received over the network
 
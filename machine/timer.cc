@@ -39,11 +39,14 @@ static void TimerHandler(int arg)
 //      "callArg" is the parameter to be passed to the interrupt handler.
 //      "doRandom" -- if true, arrange for the interrupts to occur
 //		at random, instead of fixed, intervals.
+//      "ticks" is the (average) time between interrupts.
 //----------------------------------------------------------------------
 
-Timer::Timer(VoidFunctionPtr timerHandler, int callArg, bool doRandom)
+Timer::Timer(VoidFunctionPtr timerHandler, int callArg, bool doRandom,
+	     int ticks)
 {
     randomize = doRandom;
+    period = ticks;
     handler = timerHandler;
     arg = callArg; 
 
@@ -79,7 +82,7 @@ int
 Timer::TimeOfNextInterrupt() 
 {
     if (randomize)
-	return 1 + (Random() % (TimerTicks * 2));
+	return 1 + (Random() % (period * 2));
     else
-	return TimerTicks; 
+	return period; 
 }
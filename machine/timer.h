@@ -6,7 +6,8 @@
 //	having a thread go to sleep for a specific period of time. 
 //
 //	We emulate a hardware timer by scheduling an interrupt to occur
-//	every time stats->totalTicks has increased by TimerTicks.
+//	every time stats->totalTicks has increased by "period" ticks
+//	(normally TimerTicks).
 //
 //	In order to introduce some randomness into time-slicing, if "doRandom"
 //	is set, then the interrupt comes after a random number of ticks.
@@ -26,9 +27,10 @@
 // The following class defines a hardware timer. 
 class Timer {
   public:
-    Timer(VoidFunctionPtr timerHandler, int callArg, bool doRandom);
-				// Initialize the timer, to call the interrupt
-				// handler "timerHandler" every time slice.
+    Timer(VoidFunctionPtr timerHandler, int callArg, bool doRandom,
+	  int period);		// Initialize the timer, to call the interrupt
+				// handler "timerHandler" every time slice,
+				// of "period" ticks.
     ~Timer() {}
 
 // Internal routines to the timer emulation -- DO NOT call these
@@ -41,6 +43,7 @@ class Timer {
 
   private:
     bool randomize;		// set if we need to use a random timeout delay
+    int period;			// (average) ticks between interrupts
     VoidFunctionPtr handler;	// timer interrupt handler 
     int arg;			// argument to pass to interrupt handler
 
@@ -147,6 +147,8 @@ Machine::WriteMem(int addr, int size, int value)
 	machine->RaiseException(exception, addr);
 	return FALSE;
     }
+    if (codePage[physicalAddress / PageSize])	// self-modifying code?
+	InvalidateCode(physicalAddress / PageSize);
     switch (size) {
       case 1:
 	machine->mainMemory[physicalAddress] = (unsigned char) (value & 0xff);
@@ -177,6 +179,16 @@ Machine::WriteMem(int addr, int size, int value)
 //	address in "physAddr".  If there was an error, returns the type
 //	of the exception.
 //
+//	Successful translations are remembered in a small direct-mapped
+//	cache, indexed by virtual page number, so that repeated references
+//	to the same page skip the checks below.  The use bit (and, for a
+//	write, the dirty bit) is set when an entry is filled; until the
+//	cache is flushed there is no need to set it again.  A page that
+//	has only been read through the cache must miss on its first
+//	write, so that its dirty bit and read-only bit are looked at.
+//	With a TLB, the cache only ever holds pages that are in the TLB,
+//	so a hit in the cache counts as a TLB hit.
+//
 //	"virtAddr" -- the virtual address to translate
 //	"physAddr" -- the place to store the physical address
 //	"size" -- the amount of memory being read or written
@@ -190,6 +202,23 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     unsigned int vpn, offset;
     TranslationEntry *entry;
     unsigned int pageFrame;
+    int slot;
+
+// calculate the virtual page number, and offset within the page,
+// from the virtual address
+    vpn = (unsigned) virtAddr / PageSize;
+    offset = (unsigned) virtAddr % PageSize;
+
+// fast path: an aligned reference to a recently translated page
+    slot = vpn % TranslationCacheSize;
+    if ((xlateTag[slot] == (int) vpn) && (!writing || xlateWritable[slot])
+				&& !(virtAddr & (size - 1))) {
+	*physAddr = xlateBase[slot] + offset;
+#ifdef USE_TLB
+	stats->numTLBHits++;
+#endif
+	return NoException;
+    }
 
     DEBUG('a', "\tTranslate 0x%x, %s: ", virtAddr, writing ? "write" : "read");
 
@@ -203,11 +232,6 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     ASSERT(tlb == NULL || pageTable == NULL);	
     ASSERT(tlb != NULL || pageTable != NULL);	
 
-// calculate the virtual page number, and offset within the page,
-// from the virtual address
-    vpn = (unsigned) virtAddr / PageSize;
-    offset = (unsigned) virtAddr % PageSize;
-    
     if (tlb == NULL) {		// => page table => vpn is index into table
 	if (vpn >= pageTableSize) {
 	    DEBUG('a', "virtual page # %d too large for page table size %d!\n", 
@@ -220,17 +244,19 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
 	}
 	entry = &pageTable[vpn];
     } else {
-        for (entry = NULL, i = 0; i < TLBSize; i++)
+        for (entry = NULL, i = 0; i < tlbSize; i++)
     	    if (tlb[i].valid && (tlb[i].virtualPage == vpn)) {
 		entry = &tlb[i];			// FOUND!
 		break;
 	    }
 	if (entry == NULL) {				// not found
     	    DEBUG('a', "*** no valid TLB entry found for this virtual page!\n");
+	    stats->numTLBMisses++;
     	    return PageFaultException;		// really, this is a TLB fault,
 						// the page may be in memory,
 						// but not in the TLB
 	}
+	stats->numTLBHits++;
     }
 
     if (entry->readOnly && writing) {	// trying to write to a read-only page
@@ -251,5 +277,28 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing)
     *physAddr = pageFrame * PageSize + offset;
     ASSERT((*physAddr >= 0) && ((*physAddr + size) <= MemorySize));
     DEBUG('a', "phys addr = 0x%x\n", *physAddr);
+
+    if (!DebugIsEnabled('a')) {		// keep the trace complete if
+	xlateTag[slot] = vpn;		// anyone is reading it
+	xlateBase[slot] = pageFrame * PageSize;
+	xlateWritable[slot] = writing;
+    }
     return NoException;
 }
+
+//----------------------------------------------------------------------
+// Machine::FlushTranslationCache
+// 	Forget every translation remembered by Translate.
+//
+//	The kernel must call this whenever it switches page tables, or
+//	changes an entry in the page table or TLB -- including clearing
+//	a use or dirty bit, since Translate won't set it again for a page
+//	it already has cached.
+//----------------------------------------------------------------------
+
+void
+Machine::FlushTranslationCache()
+{
+    for (int i = 0; i < TranslationCacheSize; i++)
+	xlateTag[i] = -1;
+}
@@ -111,19 +111,27 @@ MailBox::Put(PacketHeader pktHdr, MailHeader mailHdr, const char *data)
 // 	Get a message from a mailbox, parsing it into the packet header,
 //	mailbox header, and data. 
 //
-//	The calling thread waits if there are no messages in the mailbox.
+//	The calling thread waits if there are no messages in the mailbox,
+//	for at most "timeout" ticks.  Returns FALSE if no message came.
 //
 //	"pktHdr" -- address to put: source, destination machine ID's
 //	"mailHdr" -- address to put: source, destination mailbox ID's
 //	"data" -- address to put: payload message data
+//	"timeout" -- how long to wait, or WaitForever
 //----------------------------------------------------------------------
 
-void 
-MailBox::Get(PacketHeader *pktHdr, MailHeader *mailHdr, const char *data) 
+bool 
+MailBox::Get(PacketHeader *pktHdr, MailHeader *mailHdr, const char *data,
+	     int timeout) 
 { 
     DEBUG('n', "Waiting for mail in mailbox\n");
-    Mail *mail = (Mail *) messages->Remove();	// remove message from list;
+    Mail *mail = (Mail *) messages->Remove(timeout);
+						// remove message from list;
 						// will wait if list is empty
+    if (mail == NULL) {
+	DEBUG('n', "Timed out waiting for mail\n");
+	return FALSE;
+    }
 
     *pktHdr = mail->pktHdr;
     *mailHdr = mail->mailHdr;
@@ -136,6 +144,7 @@ MailBox::Get(PacketHeader *pktHdr, MailHeader *mailHdr, const char *data)
 					// the caller's buffer
     delete mail;			// we've copied out the stuff we
 					// need, we can now discard the message
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
@@ -303,16 +312,20 @@ PostOffice::Send(PacketHeader pktHdr, MailHeader mailHdr, const char* data)
 //	"pktHdr" -- address to put: source, destination machine ID's
 //	"mailHdr" -- address to put: source, destination mailbox ID's
 //	"data" -- address to put: payload message data
+//	"timeout" -- how many ticks to wait, or WaitForever.  Returns
+//		FALSE if no message arrived in time.
 //----------------------------------------------------------------------
 
-void
+bool
 PostOffice::Receive(int box, PacketHeader *pktHdr, 
-				MailHeader *mailHdr, const char* data)
+		    MailHeader *mailHdr, const char* data, int timeout)
 {
     ASSERT((box >= 0) && (box < numBoxes));
 
-    boxes[box].Get(pktHdr, mailHdr, data);
+    if (!boxes[box].Get(pktHdr, mailHdr, data, timeout))
+	return FALSE;
     ASSERT(mailHdr->length <= MaxMailSize);
+    return TRUE;
 }
 
 //----------------------------------------------------------------------
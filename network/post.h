@@ -82,10 +82,12 @@ class MailBox {
 
     void Put(PacketHeader pktHdr, MailHeader mailHdr, const char *data);
    				// Atomically put a message into the mailbox
-    void Get(PacketHeader *pktHdr, MailHeader *mailHdr, const char *data); 
+    bool Get(PacketHeader *pktHdr, MailHeader *mailHdr, const char *data,
+	     int timeout = WaitForever); 
    				// Atomically get a message out of the 
 				// mailbox (and wait if there is no message 
-				// to get!)
+				// to get!  but give up after "timeout"
+				// ticks, returning FALSE)
   private:
     SynchList *messages;	// A mailbox is just a list of arrived messages
 };
@@ -112,10 +114,14 @@ class PostOffice {
 				// machine.  The fromBox in the MailHeader is 
 				// the return box for ack's.
     
-    void Receive(int box, PacketHeader *pktHdr, 
-		MailHeader *mailHdr, const char *data);
+    bool Receive(int box, PacketHeader *pktHdr, 
+		MailHeader *mailHdr, const char *data,
+		int timeout = WaitForever);
     				// Retrieve a message from "box".  Wait if
-				// there is no message in the box.
+				// there is no message in the box -- for
+				// at most "timeout" ticks, so that a
+				// protocol can retransmit if no reply
+				// turns up.  FALSE if we gave up.
 
     void PostalDelivery();	// Wait for incoming messages, 
 				// and then put them in the correct mailbox
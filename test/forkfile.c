@@ -0,0 +1,38 @@
+/* forkfile.c
+ *	Check that the threads of a process share its open files.  The
+ *	parent opens a file, a child writes to it and exits, and the
+ *	parent reads back what the child wrote.  Exits 0 if it all
+ *	went through, 1 if not.
+ */
+
+#include "syscall.h"
+
+OpenFileId fd;
+int wrote = 0;
+
+void writer(){
+	Write("shared", 6, fd);
+	wrote = 1;
+	Exit(0);
+}
+
+int main()
+{
+	char buf[6];
+	SpaceId pid;
+
+	Create("forkfile.out");
+	fd = Open("forkfile.out");
+	if (fd < 0)
+		Exit(1);
+
+	pid = Fork(writer);
+	Join(pid);
+	Close(fd);
+
+	fd = Open("forkfile.out");
+	if (!wrote || Read(buf, 6, fd) != 6 || buf[0] != 's' || buf[5] != 'd')
+		Exit(1);
+	Close(fd);
+	Exit(0);
+}
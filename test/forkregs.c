@@ -0,0 +1,45 @@
+/* forkregs.c
+ *	Check that a parent's registers survive its children running.
+ *	The parent keeps values in registers across Fork and Join: the
+ *	first child exits without any other thread switch, the second
+ *	yields back and forth first.  Exits 0 if the parent's values are
+ *	intact afterwards, 1 if not.
+ */
+
+#include "syscall.h"
+
+int global_cnt=0;
+
+void quick(){
+	Exit(global_cnt);
+}
+
+void slow(){
+	int i;
+
+	for (i=0;i<10;i++) {
+		global_cnt++;
+		Yield();
+	}
+	Exit(global_cnt);
+}
+
+int main()
+{
+	register int a=11, b=22, c=33;
+	SpaceId pid;
+
+	pid = Fork(quick);
+	Join(pid);
+	if (a != 11 || b != 22 || c != 33)
+		Exit(1);
+
+	pid = Fork(slow);
+	Yield();
+	a += global_cnt;
+	Join(pid);
+	if (a - global_cnt > 11 || b != 22 || c != 33 || global_cnt != 10)
+		Exit(1);
+
+	Exit(0);
+}
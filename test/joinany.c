@@ -0,0 +1,35 @@
+/* joinany.c
+ *	Fork a few children that exit in some order, and reap them with
+ *	JoinAny as they finish, rather than Join'ing each one in turn.
+ */
+
+#include "syscall.h"
+
+int global_cnt=0;
+
+void work(){
+	int i;
+
+	for (i=0;i<100;i++) global_cnt++;
+	Yield();
+
+	Exit(global_cnt);
+}
+
+void fast_exit(){
+	Exit(global_cnt);
+}
+
+int main()
+{
+	int status, total=0;
+
+	Fork(work);
+	Fork(fast_exit);
+	Fork(work);
+
+	while (JoinAny(&status) != -1)
+		total++;
+
+	Exit(total);
+}
@@ -74,6 +74,14 @@ Join:
 	j	$31
 	.end Join
 
+	.globl JoinAny
+	.ent	JoinAny
+JoinAny:
+	addiu $2,$0,SC_JoinAny
+	syscall
+	j	$31
+	.end JoinAny
+
 	.globl Create
 	.ent	Create
 Create:
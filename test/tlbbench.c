@@ -0,0 +1,33 @@
+/* tlbbench.c
+ *	Simple program to measure the cost of TLB misses.
+ *
+ *	Sweeps repeatedly over a working set of WSPAGES pages, touching
+ *	one word per page, so that nearly every reference goes to a
+ *	different page.  Vary WSPAGES, and the TLB size and policy, e.g.
+ *
+ *		nachos -tlb 4 -tlbp fifo -x ../test/tlbbench
+ *		nachos -tlb 16 -tlbp clock -x ../test/tlbbench
+ *
+ *	and compare the "TLB:" line and the system ticks in the
+ *	statistics.  Once the working set no longer fits in the TLB,
+ *	FIFO misses on every reference.
+ */
+
+#include "syscall.h"
+
+#define PAGEWORDS	32		/* words per page */
+#define WSPAGES		8		/* pages in the working set */
+#define SWEEPS		200
+
+int pages[WSPAGES * PAGEWORDS];
+
+int
+main()
+{
+	int i, j, sum = 0;
+
+	for (i = 0; i < SWEEPS; i++)
+		for (j = 0; j < WSPAGES; j++)
+			sum += pages[j * PAGEWORDS]++;
+	Exit(sum);
+}
@@ -0,0 +1,27 @@
+/* vmbench.c
+ *	Simple program to exercise page replacement.
+ *
+ *	Runs matmult and sort at the same time; between them they touch
+ *	well over the number of physical pages, so pages are evicted and
+ *	brought back in throughout.  Run it once with each policy, e.g.
+ *
+ *		nachos -rp fifo -x ../test/vmbench
+ *		nachos -rp clock -x ../test/vmbench
+ *		nachos -rp lru -x ../test/vmbench
+ *
+ *	and compare the "Paging:" line of the statistics.
+ */
+
+#include "syscall.h"
+
+void runsort()
+{
+	Exec("../test/sort");
+}
+
+int
+main()
+{
+	Fork(runsort);
+	Exec("../test/matmult");
+}
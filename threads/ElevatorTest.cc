@@ -1,12 +1,34 @@
+// ElevatorTest.cc
+//	Load generator for the elevator simulation.  People arrive at
+//	random floors at random times, wanting to go to other random
+//	floors; when they have all arrived where they were going, we
+//	report the average time they waited for a car, the average time
+//	they rode in one, and the number of trips per simulated hour.
+//
+//	ElevatorTest runs one building; ElevatorBenchmark runs the same
+//	load in buildings with more cars and more floors, to see how the
+//	dispatcher scales.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
 #include "copyright.h"
 #include "system.h"
 #include "synch.h"
 #include "elevator.h"
 
-void ElevatorTest(int numFloors, int numPersons) {
+//----------------------------------------------------------------------
+// RunBuilding
+// 	Send "numPersons" people through a building with "numFloors"
+//	floors and "numCars" cars, arriving on average every
+//	PersonArrivalTicks, and print how it went.
+//----------------------------------------------------------------------
 
-    // Create elevator thread
-    Elevator(numFloors);
+static void
+RunBuilding(int numFloors, int numCars, int numPersons)
+{
+    Building *building = Elevator(numFloors, numCars);
 
     for (int i = 0 ; i < numPersons; i++) {
         int atFloor = (Random() % numFloors); // choose a random atFloor
@@ -17,9 +39,52 @@ void ElevatorTest(int numFloors, int numPersons) {
 
         ArrivingGoingFromTo(atFloor, toFloor);
 
-        for(int j =0 ; j< 1000000; j++) {
-            currentThread->Yield();
-        }
+        // Wait a while before the next person arrives
+        currentThread->SleepUntil(stats->totalTicks + 1
+                                  + Random() % (2 * PersonArrivalTicks));
     }
 
-}
\ No newline at end of file
+    building->WaitForTrips(numPersons);
+    building->Shutdown();
+    printf("%6d %6d %6d %10.0f %10.0f %10.1f\n", numFloors, numCars,
+           building->NumTrips(), building->AverageWait(),
+           building->AverageRide(), building->TripsPerHour());
+    delete building;
+}
+
+static void
+PrintHeading()
+{
+    printf("%6s %6s %6s %10s %10s %10s\n", "floors", "cars", "trips",
+           "avg wait", "avg ride", "trips/hr");
+}
+
+//----------------------------------------------------------------------
+// ElevatorTest
+// 	Run "numPersons" people through a building with "numFloors"
+//	floors and one car.
+//----------------------------------------------------------------------
+
+void ElevatorTest(int numFloors, int numPersons) {
+
+    PrintHeading();
+    RunBuilding(numFloors, 1, numPersons);
+}
+
+//----------------------------------------------------------------------
+// ElevatorBenchmark
+// 	Run the same load of "numPersons" people through buildings of
+//	5, 10 and 20 floors, with 1, 2 and 4 cars each.  Times are in
+//	ticks.
+//----------------------------------------------------------------------
+
+void ElevatorBenchmark(int numPersons) {
+
+    static const int floorCounts[] = { 5, 10, 20 };
+    static const int carCounts[] = { 1, 2, 4 };
+
+    PrintHeading();
+    for (int f = 0; f < 3; f++)
+        for (int c = 0; c < 3; c++)
+            RunBuilding(floorCounts[f], carCounts[c], numPersons);
+}
@@ -0,0 +1,163 @@
+// alarm.cc 
+//	Routines to put threads to sleep until a given time, and to 
+//	wake them up again.
+//
+//	The alarm is driven by interrupts scheduled through
+//	Interrupt::Schedule, the same way the hardware devices
+//	are.  There is at most one alarm interrupt outstanding that
+//	we are counting on -- the one for the earliest sleeper.  If a
+//	thread goes to sleep with an earlier wakeup time, a new
+//	interrupt is scheduled; the later one then goes off with 
+//	nothing to do, which is harmless.
+//
+//	The same queue is used for timeouts: a thread waiting on a
+//	synchronization variable for a limited time is put on it too,
+//	and if it is still blocked when its time comes, it is taken off
+//	the synchronization variable's wait queue and woken up.
+//
+//	All of these routines run with interrupts disabled.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "alarm.h"
+#include "system.h"
+
+// Dummy function because C++ does not allow pointers to member functions
+static void AlarmHandler(int arg)
+{ Alarm *p = (Alarm *)arg; p->WakeUp(); }
+
+//----------------------------------------------------------------------
+// Alarm::Alarm
+// 	Initialize the queue of sleeping threads to empty.
+//----------------------------------------------------------------------
+
+Alarm::Alarm()
+{
+    sleepers = new IntrusiveList;
+    nextAlarm = -1;
+}
+
+//----------------------------------------------------------------------
+// Alarm::~Alarm
+// 	De-allocate the queue of sleeping threads.
+//----------------------------------------------------------------------
+
+Alarm::~Alarm()
+{
+    delete sleepers;
+}
+
+//----------------------------------------------------------------------
+// Alarm::WaitUntil
+// 	Put the current thread to sleep, until simulated time reaches
+//	"when".  Returns immediately if that time has already passed.
+//
+//	"when" is the time to wake up, in ticks.
+//----------------------------------------------------------------------
+
+void
+Alarm::WaitUntil(int when)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (when > stats->totalTicks) {
+	DEBUG('t', "Thread \"%s\" sleeping until %d\n",
+	      currentThread->getName(), when);
+	sleepers->SortedInsert(&currentThread->sleepLink, when);
+	if (nextAlarm == -1 || when < nextAlarm)
+	    ScheduleAlarm(when);
+	currentThread->Sleep();
+    }
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Alarm::SetTimeout
+// 	Arrange for "thread", which is about to wait on some queue, to
+//	be woken at time "when" if it hasn't been woken by then.  The
+//	thread must call CancelTimeout once it is running again.
+//
+//	"thread" is the thread that is going to wait.
+//	"when" is the time to give up waiting, in ticks.
+//----------------------------------------------------------------------
+
+void
+Alarm::SetTimeout(Thread *thread, int when)
+{
+    ASSERT(interrupt->getLevel() == IntOff);
+
+    thread->timedOut = FALSE;
+    sleepers->SortedInsert(&thread->sleepLink, when);
+    if (nextAlarm == -1 || when < nextAlarm)
+	ScheduleAlarm(when);
+}
+
+//----------------------------------------------------------------------
+// Alarm::CancelTimeout
+// 	A thread with a timeout is running again -- woken up normally, or
+//	because it timed out.  Take it off the wakeup queue, if it is
+//	still there.  (We don't bother cancelling the alarm interrupt.)
+//
+//	"thread" is the thread that was waiting.
+//----------------------------------------------------------------------
+
+void
+Alarm::CancelTimeout(Thread *thread)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    if (thread->sleepLink.IsLinked())
+	sleepers->RemoveLink(&thread->sleepLink);
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// Alarm::WakeUp
+// 	An alarm interrupt has gone off.  Move every thread whose
+//	wakeup time has come to the ready list, then arrange for an
+//	interrupt at the next wakeup time, if anyone is still asleep.
+//
+//	A thread with a timeout that is still blocked is taken off the
+//	queue it's waiting on first.  One that has already been woken
+//	(and so isn't blocked) is left alone.
+//----------------------------------------------------------------------
+
+void
+Alarm::WakeUp()
+{
+    Thread *thread;
+    int when;
+
+    nextAlarm = -1;
+    while ((thread = (Thread *)sleepers->SortedFirst(&when)) != NULL
+	   && when <= stats->totalTicks) {
+	(void) sleepers->SortedRemove(&when);
+	if (thread->getStatus() != BLOCKED)
+	    continue;			// woken in time; not our business
+	if (thread->queueLink.IsLinked()) {	// give up waiting
+	    thread->queueLink.list->RemoveLink(&thread->queueLink);
+	    thread->timedOut = TRUE;
+	}
+	DEBUG('t', "Waking thread \"%s\" at %d\n", thread->getName(),
+	      stats->totalTicks);
+	scheduler->ReadyToRun(thread);
+    }
+    if (thread != NULL)
+	ScheduleAlarm(when);
+}
+
+//----------------------------------------------------------------------
+// Alarm::ScheduleAlarm
+// 	Ask for an alarm interrupt at time "when".
+//----------------------------------------------------------------------
+
+void
+Alarm::ScheduleAlarm(int when)
+{
+    interrupt->Schedule(AlarmHandler, (int) this, when - stats->totalTicks,
+			AlarmInt);
+    nextAlarm = when;
+}
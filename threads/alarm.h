@@ -0,0 +1,52 @@
+// alarm.h 
+//	Data structures for a software alarm clock, which lets a thread
+//	go to sleep until a given (simulated) time.
+//
+//	Sleeping threads are kept on a queue sorted by wakeup time.  We
+//	only ask for an interrupt at the earliest wakeup time, so a
+//	sleep costs one interrupt, instead of a Yield on every trip
+//	through a busy loop -- and when every thread is asleep,
+//	Interrupt::Idle can skip straight to the next wakeup.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef ALARM_H
+#define ALARM_H
+
+#include "copyright.h"
+#include "list.h"
+
+class Thread;
+
+// The following class defines the alarm clock.
+
+class Alarm {
+  public:
+    Alarm();				// Initialize the wakeup queue
+    ~Alarm();				// De-allocate the wakeup queue
+
+    void WaitUntil(int when);		// Put currentThread to sleep until
+					// stats->totalTicks reaches "when"
+
+    void SetTimeout(Thread *thread, int when); // If "thread" is still
+					// blocked at time "when", take it off
+					// the queue it's waiting on, set its
+					// "timedOut", and wake it up
+    void CancelTimeout(Thread *thread);	// "thread" was woken in time
+
+    void WakeUp();			// Called when an alarm interrupt
+					// goes off; wakes every thread
+					// that is due
+
+  private:
+    IntrusiveList *sleepers;		// sleeping threads, sorted by 
+					// wakeup time
+    int nextAlarm;			// time of the earliest pending alarm
+					// interrupt, -1 if none
+
+    void ScheduleAlarm(int when);	// ask for an interrupt at "when"
+};
+
+#endif // ALARM_H
@@ -1,179 +1,500 @@
+// elevator.cc
+//	Routines to simulate a bank of elevators, with a dispatcher that
+//	hands each hall call to the car it expects to get there first,
+//	and LOOK scheduling within each car.
+//
+//	A person waits on the hall condition for their floor and
+//	direction until a car going their way opens its doors there,
+//	gets in (if there's room), presses the button for their floor,
+//	and waits on the car's condition until the car opens its doors
+//	there.  A person left behind by a full car has their call
+//	dispatched again when the doors close.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
+
 #include "copyright.h"
 #include "system.h"
 #include "synch.h"
 #include "elevator.h"
 
+static Building *building;	// for ArrivingGoingFromTo
 
-int nextPersonID = 1;
-Lock *personIDLock = new Lock("PersonIDLock");
-
-
-ELEVATOR *e;
+// Index into the per-direction hall call arrays
+static int
+Hall(int direction)
+{
+    return direction > 0 ? 0 : 1;
+}
 
+static int
+Distance(int from, int to)
+{
+    return from < to ? to - from : from - to;
+}
 
-void ELEVATOR::start(int numFloors) {
-    
-    while(1) {
-        // A. Wait until hailed
-        while (totalPersonsWaiting(numFloors)== 0 && occupancy == 0){
-            elevatorLock->Acquire();
-            personArrived->Wait(elevatorLock);
-            elevatorLock->Release();
-        }
+//----------------------------------------------------------------------
+// CarThread
+// 	Dummy function because C++ can't indirectly invoke member functions.
+//----------------------------------------------------------------------
 
-        // B. While there are active persons, loop doing the following
-        while (occupancy > 0 || totalPersonsWaiting(numFloors) > 0){
-        //      0. Acquire elevatorLock
-            elevatorLock->Acquire();
-        //      1. Signal persons inside elevator to get off (leaving->broadcast(elevatorLock))
-            leaving[currentFloor]->Broadcast(elevatorLock);
-            elevatorLock->Release();
-            currentThread->Yield();
-            elevatorLock->Acquire();
-        //      2. Signal persons atFloor to get in, one at a time, checking occupancyLimit each time
-            while(occupancy <= maxOccupancy){
-                entering[currentFloor]->Signal(elevatorLock);
-                elevatorLock->Release();
-                currentThread->Yield();
-                elevatorLock->Acquire();
-            }
-        //      2.5 Release elevatorLock
-
-            elevatorLock->Release();
-        //      3. Spin for some time
-                for(int j =0 ; j< 1000000; j++) {
-                    currentThread->Yield();
-                }
-        //      4. Go to next floor
-            
-            if(directionUp){
-                currentFloor++;
-            }
-            else{
-            currentFloor--;
-            }
-            printf("Elevator arrives on floor %d", currentFloor);
-        
-        }
-        
-    }
+static void
+CarThread(int car)
+{
+    ((Car *) car)->Run();
 }
 
-void ElevatorThread(int numFloors) {
+//----------------------------------------------------------------------
+// Car::Car, Car::~Car
+// 	Initialize a car, idle on the ground floor, or de-allocate it.
+//----------------------------------------------------------------------
+
+Car::Car(Building *b, int carId, int floors)
+{
+    building = b;
+    id = carId;
+    numFloors = floors;
+    floor = 0;
+    direction = 1;
+    riders = 0;
+    doorsOpen = FALSE;
+    stopsFor = new int[numFloors];
+    for (int i = 0; i < numFloors; i++)
+        stopsFor[i] = 0;
+    arrived = new Condition("car arrived");
+    wakeUp = new Condition("car has work");
+}
 
-    e = new ELEVATOR(numFloors);
-    printf("Elevator with %d floors was created!\n", numFloors);
+Car::~Car()
+{
+    delete [] stopsFor;
+    delete arrived;
+    delete wakeUp;
+}
 
-    e->start(numFloors);
+//----------------------------------------------------------------------
+// Car::HasWork, Car::WorkAhead, Car::ShouldStop
+// 	Questions a car asks itself at each floor.  A car has work if
+//	riders want some floor, or it has been given hall calls.  It
+//	stops for its riders, for its calls in the direction it is going,
+//	and for anyone waiting to go that way, if it has room.
+//
+//	The building's lock must be held.
+//----------------------------------------------------------------------
+
+bool
+Car::HasWork()
+{
+    for (int f = 0; f < numFloors; f++)
+        if (stopsFor[f] > 0 || building->assigned[0][f] == this
+              || building->assigned[1][f] == this)
+            return TRUE;
+    return FALSE;
+}
 
+bool
+Car::WorkAhead(int dir)
+{
+    for (int f = floor + dir; f >= 0 && f < numFloors; f += dir)
+        if (stopsFor[f] > 0 || building->assigned[0][f] == this
+              || building->assigned[1][f] == this)
+            return TRUE;
+    return FALSE;
 }
 
-ELEVATOR::ELEVATOR(int numFloors) {
-    currentFloor = 1;
-    occupancy = 0;
-    maxOccupancy = 5;
-    directionUp = TRUE;
+bool
+Car::ShouldStop()
+{
+    int hall = Hall(direction);
+
+    if (stopsFor[floor] > 0)
+        return TRUE;
+    if (riders == CarCapacity)
+        return FALSE;			// no room for anyone else
+    return building->assigned[hall][floor] == this
+        || building->waiting[hall][floor] > 0;
+}
 
-     // Initialize entering
-    entering = new Condition*[numFloors];
-    for (int i = 0; i < numFloors; i++) {
-        entering[i] = new Condition("Entering " + i);
-    }
-    personsWaiting = new int[numFloors];
-    elevatorLock = new Lock("ElevatorLock");
+//----------------------------------------------------------------------
+// Car::LastStop, Car::PendingStops, Car::EstimatedArrival
+// 	Estimate how long it would take this car to answer a hall call
+//	at "callFloor", for people going "callDirection".
+//
+//	An idle car goes straight there, as does a car that will pass
+//	the floor going the right way.  Otherwise the car has to finish
+//	its sweep first, and come back.  Each stop along the way adds
+//	the time the doors are open.
+//
+//	The building's lock must be held.
+//----------------------------------------------------------------------
+
+int
+Car::LastStop(int dir)
+{
+    int last = floor;
+
+    for (int f = floor + dir; f >= 0 && f < numFloors; f += dir)
+        if (stopsFor[f] > 0 || building->assigned[0][f] == this
+              || building->assigned[1][f] == this)
+            last = f;
+    return last;
+}
 
-    personArrived = new Condition ("personArrived");
+int
+Car::PendingStops()
+{
+    int stops = 0;
 
-    // Initialize leaving
-    leaving = new Condition*[numFloors];
-    for (int i = 0; i < numFloors; i++) {
-        leaving[i] = new Condition("Leaving " + i);
-    }
+    for (int f = 0; f < numFloors; f++)
+        if (stopsFor[f] > 0 || building->assigned[0][f] == this
+              || building->assigned[1][f] == this)
+            stops++;
+    return stops;
 }
 
-int ELEVATOR::totalPersonsWaiting(int numFloors){
-    int totalPersons = 0;
-    for (int i = 0; i < numFloors; i++){
-        totalPersons += personsWaiting[i];
-
+int
+Car::EstimatedArrival(int callFloor, int callDirection)
+{
+    int distance;
+
+    if (!HasWork())
+        distance = Distance(floor, callFloor);
+    else if (callDirection == direction
+               && (callFloor - floor) * direction >= 0)
+        distance = Distance(floor, callFloor);	// on our way
+    else {
+        int last = LastStop(direction);		// finish this sweep first
+        distance = Distance(floor, last) + Distance(last, callFloor);
     }
-    return totalPersons;
+    return distance * FloorTravelTicks + PendingStops() * DoorTicks;
+}
 
+//----------------------------------------------------------------------
+// Car::OpenDoors
+// 	Stop at the current floor: let out the riders who want it, and
+//	let in whoever is waiting to go our way.  This answers the hall
+//	call here, whichever car it was given to.  If the car fills up
+//	before everyone gets in, the rest call another car.
+//
+//	The building's lock must be held; it is released while the
+//	doors are open.
+//----------------------------------------------------------------------
+
+void
+Car::OpenDoors()
+{
+    int hall = Hall(direction);
+    Lock *lock = building->lock;
+
+    DEBUG('e', "Car %d opens its doors on floor %d, going %s\n", id, floor,
+          direction > 0 ? "up" : "down");
+    building->assigned[hall][floor] = NULL;
+    building->boarding[hall][floor] = this;
+    doorsOpen = TRUE;
+    arrived->Broadcast(lock);			// riders for here get out
+    building->hall[hall][floor]->Broadcast(lock);	// and others get in
+
+    lock->Release();
+    currentThread->SleepUntil(stats->totalTicks + DoorTicks);
+    lock->Acquire();
+
+    doorsOpen = FALSE;
+    if (building->boarding[hall][floor] == this)
+        building->boarding[hall][floor] = NULL;
+    if (building->waiting[hall][floor] > 0
+          && building->assigned[hall][floor] == NULL)
+        building->Dispatch(floor, direction);	// left behind
 }
 
+//----------------------------------------------------------------------
+// Car::Move
+// 	Travel to the next floor in the direction we're going.
+//
+//	The building's lock must be held; it is released on the way.
+//----------------------------------------------------------------------
+
+void
+Car::Move()
+{
+    ASSERT(floor + direction >= 0 && floor + direction < numFloors);
+
+    building->lock->Release();
+    currentThread->SleepUntil(stats->totalTicks + FloorTravelTicks);
+    building->lock->Acquire();
+    floor += direction;
+    DEBUG('e', "Car %d arrives at floor %d\n", id, floor);
+}
 
-void Elevator(int numFloors) {
-    // Create Elevator Thread
-    Thread *t = new Thread("Elevator");
-    t->Fork(ElevatorThread, numFloors);
+//----------------------------------------------------------------------
+// Car::Run
+// 	The car's thread.  Sleep until there is work; then keep going
+//	in the same direction while there is work ahead, stopping where
+//	we're wanted, and turn around when there isn't (LOOK).  Quit
+//	once the building shuts down and we're idle.
+//----------------------------------------------------------------------
+
+void
+Car::Run()
+{
+    Lock *lock = building->lock;
+
+    lock->Acquire();
+    for (;;) {
+        while (!HasWork() && !building->shuttingDown)
+            wakeUp->Wait(lock);
+        if (!HasWork())
+            break;			// shutting down
+
+        if (!WorkAhead(direction) && !ShouldStop())
+            direction = -direction;	// nothing more this way
+        if (ShouldStop())
+            OpenDoors();
+        else
+            Move();
+    }
+    building->carsRunning--;
+    building->carStopped->Broadcast(lock);
+    lock->Release();
 }
 
+//----------------------------------------------------------------------
+// Building::Building
+// 	Initialize a building, and start its cars running.
+//
+//	"numFloors" is how many floors it has.
+//	"numCars" is how many elevator cars it has.
+//----------------------------------------------------------------------
+
+Building::Building(int floors, int carCount)
+{
+    numFloors = floors;
+    numCars = carCount;
+    lock = new Lock("building");
+    for (int h = 0; h < 2; h++) {
+        waiting[h] = new int[numFloors];
+        assigned[h] = new Car *[numFloors];
+        boarding[h] = new Car *[numFloors];
+        hall[h] = new Condition *[numFloors];
+        for (int f = 0; f < numFloors; f++) {
+            waiting[h][f] = 0;
+            assigned[h][f] = NULL;
+            boarding[h][f] = NULL;
+            hall[h][f] = new Condition("hall");
+        }
+    }
+    tripDone = new Condition("trip done");
+    carStopped = new Condition("car stopped");
+    shuttingDown = FALSE;
+    nextPersonID = 1;
+    openTime = lastTripTime = stats->totalTicks;
+    trips = 0;
+    totalWait = totalRide = 0.0;
+
+    cars = new Car *[numCars];
+    carsRunning = numCars;
+    for (int i = 0; i < numCars; i++) {
+        cars[i] = new Car(this, i, numFloors);
+        Thread *t = new Thread("car");
+        t->Fork(CarThread, (int) cars[i]);
+    }
+}
 
-void ELEVATOR::hailElevator(Person *p) {
-    // 1. Increment waiting persons atFloor
-    
-    personsWaiting[p->atFloor]++;
-    if(p->atFloor < p->toFloor){
-        directionUp = TRUE;
+//----------------------------------------------------------------------
+// Building::~Building
+// 	De-allocate a building.  The cars must have been shut down, and
+//	everyone must have finished their trips.
+//----------------------------------------------------------------------
+
+Building::~Building()
+{
+    ASSERT(carsRunning == 0);
+    for (int i = 0; i < numCars; i++)
+        delete cars[i];
+    delete [] cars;
+    for (int h = 0; h < 2; h++) {
+        for (int f = 0; f < numFloors; f++)
+            delete hall[h][f];
+        delete [] waiting[h];
+        delete [] assigned[h];
+        delete [] boarding[h];
+        delete [] hall[h];
     }
-    if(p->atFloor > p->toFloor){
-        directionUp = FALSE;
+    delete tripDone;
+    delete carStopped;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// Building::Dispatch
+// 	Give the hall call at "floor", for people going "direction", to
+//	the car we estimate will get there first, and wake it if it is
+//	idle.
+//
+//	The lock must be held.
+//----------------------------------------------------------------------
+
+void
+Building::Dispatch(int floor, int direction)
+{
+    Car *best = NULL;
+    int bestTicks = 0;
+
+    for (int i = 0; i < numCars; i++) {
+        int ticks = cars[i]->EstimatedArrival(floor, direction);
+        if (best == NULL || ticks < bestTicks) {
+            best = cars[i];
+            bestTicks = ticks;
+        }
     }
-    // 1.5 Acquire elevatorLock;
-    elevatorLock->Acquire();
-    // 2. Hail Elevator
-    personArrived->Signal(elevatorLock);
-    
-    // 3. Wait for elevator to arrive atFloor [entering[p->atFloor]->wait(elevatorLock)]
-    entering[p->atFloor]->Wait(elevatorLock);
-    // 5. Get into elevator
-    printf("Person %d got into the elevator.\n", p->id);
-    // 6. Decrement persons waiting atFloor [personsWaiting[atFloor]++]
-    personsWaiting[p->atFloor]++;
-    // 7. Increment persons inside elevator [occupancy++]
-    occupancy++;
-    // 8. Wait for elevator to reach toFloor [leaving[p->toFloor]->wait(elevatorLock)]
-    leaving[p->toFloor]->Wait(elevatorLock);
-    // 9. Get out of the elevator
-    printf("Person %d got out of the elevator.\n", p->id);
-    // 10. Decrement persons inside elevator
-    occupancy--;
-    // 11. Release elevatorLock;
-    elevatorLock->Release();
+    DEBUG('e', "Hall call on floor %d going %s goes to car %d (eta %d)\n",
+          floor, direction > 0 ? "up" : "down", best->id, bestTicks);
+    assigned[Hall(direction)][floor] = best;
+    best->wakeUp->Signal(lock);
 }
 
-void PersonThread(int person) {
+//----------------------------------------------------------------------
+// Building::NewPerson
+// 	Create a person who wants to go from "atFloor" to "toFloor".
+//----------------------------------------------------------------------
 
-    Person *p = (Person *)person;
+Person *
+Building::NewPerson(int atFloor, int toFloor)
+{
+    ASSERT(atFloor >= 0 && atFloor < numFloors);
+    ASSERT(toFloor >= 0 && toFloor < numFloors && toFloor != atFloor);
 
-    printf("Person %d wants to go from floor %d to %d\n", p->id, p->atFloor, p->toFloor);
+    Person *p = new Person;
+    lock->Acquire();
+    p->id = nextPersonID++;
+    lock->Release();
+    p->atFloor = atFloor;
+    p->toFloor = toFloor;
+    return p;
+}
 
-    e->hailElevator(p);
+//----------------------------------------------------------------------
+// Building::Travel
+// 	Take person "p" from their floor to the one they want: call a
+//	car, unless one is already coming or already here with its doors
+//	open, get in when there's room, and get out at "p->toFloor".
+//----------------------------------------------------------------------
+
+void
+Building::Travel(Person *p)
+{
+    int direction = p->toFloor > p->atFloor ? 1 : -1;
+    int h = Hall(direction);
+    Car *car;
+
+    lock->Acquire();
+    p->arrivalTime = stats->totalTicks;
+    DEBUG('e', "Person %d wants to go from floor %d to %d\n", p->id,
+          p->atFloor, p->toFloor);
+    waiting[h][p->atFloor]++;
+    if (assigned[h][p->atFloor] == NULL && boarding[h][p->atFloor] == NULL)
+        Dispatch(p->atFloor, direction);
+
+    while ((car = boarding[h][p->atFloor]) == NULL
+             || car->riders == CarCapacity)
+        hall[h][p->atFloor]->Wait(lock);
+
+    waiting[h][p->atFloor]--;
+    car->riders++;
+    car->stopsFor[p->toFloor]++;
+    p->boardingTime = stats->totalTicks;
+    DEBUG('e', "Person %d got into car %d\n", p->id, car->id);
+
+    while (car->floor != p->toFloor || !car->doorsOpen)
+        car->arrived->Wait(lock);
+
+    car->riders--;
+    car->stopsFor[p->toFloor]--;
+    DEBUG('e', "Person %d got out of car %d\n", p->id, car->id);
+    trips++;
+    totalWait += p->boardingTime - p->arrivalTime;
+    totalRide += stats->totalTicks - p->boardingTime;
+    lastTripTime = stats->totalTicks;
+    tripDone->Broadcast(lock);
+    lock->Release();
+}
 
+//----------------------------------------------------------------------
+// Building::WaitForTrips
+// 	Wait until "numTrips" trips in all have been completed.
+//----------------------------------------------------------------------
+
+void
+Building::WaitForTrips(int numTrips)
+{
+    lock->Acquire();
+    while (trips < numTrips)
+        tripDone->Wait(lock);
+    lock->Release();
 }
 
-int getNextPersonID() {
-    int personID = nextPersonID;
-    personIDLock->Acquire();
-    nextPersonID = nextPersonID + 1;
-    personIDLock->Release();
-    return personID;
+//----------------------------------------------------------------------
+// Building::Shutdown
+// 	Tell the cars to stop once they have nothing left to do, and
+//	wait until they all have.
+//----------------------------------------------------------------------
+
+void
+Building::Shutdown()
+{
+    lock->Acquire();
+    shuttingDown = TRUE;
+    for (int i = 0; i < numCars; i++)
+        cars[i]->wakeUp->Signal(lock);
+    while (carsRunning > 0)
+        carStopped->Wait(lock);
+    lock->Release();
 }
 
+//----------------------------------------------------------------------
+// Building::TripsPerHour
+// 	Throughput, in trips per simulated hour (TicksPerHour).
+//----------------------------------------------------------------------
 
-void ArrivingGoingFromTo(int atFloor, int toFloor) {
+double
+Building::TripsPerHour()
+{
+    int elapsed = lastTripTime - openTime;
 
+    if (elapsed == 0)
+        return 0.0;
+    return (double) trips * TicksPerHour / elapsed;
+}
 
-    // Create Person struct
-    Person *p = new Person;
-    p->id = getNextPersonID();
-    p->atFloor = atFloor;
-    p->toFloor = toFloor;
+//----------------------------------------------------------------------
+// Elevator, ArrivingGoingFromTo
+// 	The interface used by ElevatorTest: create a building, then
+//	fork a thread for each person who arrives.
+//----------------------------------------------------------------------
+
+Building *
+Elevator(int numFloors, int numCars)
+{
+    building = new Building(numFloors, numCars);
+    DEBUG('e', "Building with %d floors and %d cars was created\n",
+          numFloors, numCars);
+    return building;
+}
+
+static void
+PersonThread(int person)
+{
+    Person *p = (Person *) person;
 
-    // Creates Person Thread
-    Thread *t = new Thread("Person " + p->id);
-    t->Fork(PersonThread, (int)p);
+    building->Travel(p);
+    delete p;
+}
 
-    
+void
+ArrivingGoingFromTo(int atFloor, int toFloor)
+{
+    Person *p = building->NewPerson(atFloor, toFloor);
 
-}
\ No newline at end of file
+    Thread *t = new Thread("person");
+    t->Fork(PersonThread, (int) p);
+}
@@ -1,3 +1,22 @@
+// elevator.h
+//	Data structures for simulating a bank of elevators.
+//
+//	A Building has some number of floors and some number of Cars.
+//	Each car runs in its own thread, and each person riding is a
+//	thread too.  A person arriving on a floor presses the hall button
+//	for the direction they want to go; the building's dispatcher gives
+//	that hall call to the car that it estimates can get there first.
+//	Cars sweep up and down (LOOK): each keeps going in one direction
+//	while it has riders to drop off or calls to answer that way, then
+//	turns around, and sleeps when it has nothing to do.
+//
+//	Everything in the building, cars included, is protected by one
+//	lock.  Travelling between floors and holding the doors open are
+//	done by sleeping on the alarm, with the lock released.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation
+// of liability and disclaimer of warranty provisions.
 
 #ifndef ELEVATOR_H
 #define ELEVATOR_H
@@ -5,37 +24,113 @@
 #include "copyright.h"
 #include "synch.h"
 
-void Elevator(int numFloors);
-void ArrivingGoingFromTo(int atFloor, int toFloor);
+#define FloorTravelTicks 1000	// how long it takes a car to go
+				// from one floor to the next
+#define DoorTicks 500		// how long a car's doors stay open
+#define CarCapacity 5		// how many people fit in a car
+#define PersonArrivalTicks 5000	// average time between people arriving,
+				// in ElevatorTest
+#define TicksPerHour 1800000	// a simulated hour, taking
+				// FloorTravelTicks to be two seconds
 
 typedef struct Person {
     int id;
     int atFloor;
     int toFloor;
+    int arrivalTime;		// when they pressed the hall button
+    int boardingTime;		// when they got into a car
 } Person;
 
+class Building;
+
+// The following class defines one elevator car.
+
+class Car {
+  public:
+    Car(Building *building, int id, int numFloors);
+    ~Car();
+
+    void Run();			// the car's thread: sweep up and down
+				// until the building shuts down
+
+  private:
+    friend class Building;
+
+    Building *building;		// where we are
+    int id;			// for debugging
+    int numFloors;
+    int floor;			// the floor we're at, or last passed
+    int direction;		// +1 going up, -1 going down
+    int riders;			// how many people are inside
+    int *stopsFor;		// how many riders want each floor
+    bool doorsOpen;		// TRUE while stopped at "floor"
+    Condition *arrived;		// riders wait here for their floor
+    Condition *wakeUp;		// we wait here when we have no work
+
+    bool HasWork();		// any riders or hall calls at all?
+    bool WorkAhead(int dir);	// any beyond "floor" going "dir"?
+    bool ShouldStop();		// stop at "floor" going "direction"?
+    int LastStop(int dir);	// farthest floor we must visit going "dir"
+    int PendingStops();		// how many stops we have ahead of us
+    int EstimatedArrival(int callFloor, int callDirection);
+				// ticks until we could answer a call
+    void OpenDoors();		// let riders out and people in
+    void Move();		// go to the next floor in "direction"
+};
+
+// The following class defines a building: its floors, its cars, and the
+// dispatcher that decides which car answers each hall call.
+
+class Building {
+  public:
+    Building(int numFloors, int numCars);
+				// build it, and start the cars running
+    ~Building();		// call Shutdown first
+
+    Person *NewPerson(int atFloor, int toFloor);
+    void Travel(Person *p);	// ride from p->atFloor to p->toFloor;
+				// called by the person's thread
+    void WaitForTrips(int numTrips);
+				// wait until that many trips are done
+    void Shutdown();		// stop the cars once they are idle
 
-class ELEVATOR {
+    int NumTrips() { return trips; }
+    double AverageWait() { return trips ? totalWait / trips : 0.0; }
+    double AverageRide() { return trips ? totalRide / trips : 0.0; }
+    double TripsPerHour();	// from when the building opened until
+				// the last trip was done
 
-public:
-    ELEVATOR(int numFloors);
-    ~ELEVATOR();
-    void hailElevator(Person *p);
-    void start(int numFloors);
-    int totalPersonsWaiting(int numFloors);
-    
+  private:
+    friend class Car;
 
-private:
-    int currentFloor;
-    Condition **entering;
-    Condition **leaving;
-    Condition *personArrived;
-    int *personsWaiting;
-    int occupancy;
-    int maxOccupancy;
-    Lock *elevatorLock;
-    bool directionUp;
+    int numFloors;
+    int numCars;
+    Car **cars;
+    Lock *lock;			// protects the building and its cars
+    int *waiting[2];		// people waiting at each floor, going
+				// up [0] and down [1]
+    Car **assigned[2];		// car answering each hall call, or NULL
+    Car **boarding[2];		// car with its doors open, or NULL
+    Condition **hall[2];	// people wait here for a car
+    Condition *tripDone;	// signalled as each rider gets out
+    Condition *carStopped;	// signalled as each car shuts down
+    int carsRunning;
+    bool shuttingDown;
 
+    int nextPersonID;
+    int openTime;		// when the building was created
+    int lastTripTime;		// when the last rider got out
+    int trips;			// statistics
+    double totalWait;
+    double totalRide;
+
+    void Dispatch(int floor, int direction);
+				// give a hall call to the best car
 };
 
-#endif
\ No newline at end of file
+Building *Elevator(int numFloors, int numCars = 1);
+				// create a building, for ArrivingGoingFromTo
+void ArrivingGoingFromTo(int atFloor, int toFloor);
+				// fork a person to ride in it
+
+#endif // ELEVATOR_H
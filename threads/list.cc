@@ -6,6 +6,10 @@
 //	list; it is de-allocated when the item is removed. This means
 //      we don't need to keep a "next" pointer in every object we
 //      want to put on a list.
+//
+//	Also, routines to manage an intrusive doubly-linked list, where
+//	we do keep the links in the objects on the list, and so never
+//	allocate anything.
 // 
 //     	NOTE: Mutual exclusion must be provided by the caller.
 //  	If you want a synchronized list, you must use the routines 
@@ -18,6 +22,8 @@
 #include "copyright.h"
 #include "list.h"
 
+int ListElement::numAllocated = 0;
+
 //----------------------------------------------------------------------
 // ListElement::ListElement
 // 	Initialize a list element, so it can be added somewhere on a list.
@@ -32,6 +38,7 @@ ListElement::ListElement(void *itemPtr, int sortKey)
      item = itemPtr;
      key = sortKey;
      next = NULL;	// assume we'll put it at the end of the list 
+     numAllocated++;
 }
 
 //----------------------------------------------------------------------
@@ -299,3 +306,207 @@ List::SortedRemove(int *keyPtr)
     return thing;
 }
 
+//----------------------------------------------------------------------
+// ListLink::ListLink
+// 	Initialize a link, so it can be put on an intrusive list.
+//	The object it's embedded in must set "item".
+//----------------------------------------------------------------------
+
+ListLink::ListLink()
+{
+    item = NULL;
+    prev = next = NULL;
+    key = 0;
+    list = NULL;
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList::IntrusiveList
+//	Initialize an intrusive list, empty to start with.
+//----------------------------------------------------------------------
+
+IntrusiveList::IntrusiveList()
+{ 
+    first = last = NULL; 
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList::~IntrusiveList
+//	Prepare a list for deallocation.  There is nothing to free, but
+//	any links still on the list are taken off it, so they can be
+//	put on another list.
+//----------------------------------------------------------------------
+
+IntrusiveList::~IntrusiveList()
+{ 
+    while (Remove() != NULL)
+	;
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList::InsertAfter
+//	Put a link on the list, after "prev", or at the front if "prev"
+//	is NULL.
+//----------------------------------------------------------------------
+
+void
+IntrusiveList::InsertAfter(ListLink *prev, ListLink *link)
+{
+    ASSERT(!link->IsLinked());
+
+    link->prev = prev;
+    link->next = (prev == NULL) ? first : prev->next;
+    if (link->next == NULL)
+	last = link;
+    else
+	link->next->prev = link;
+    if (prev == NULL)
+	first = link;
+    else
+	prev->next = link;
+    link->list = this;
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList::Append, IntrusiveList::Prepend
+//      Put a link at the end, or the front, of the list.
+//
+//	"link" is the link to put on the list; it can't already be on 
+//		a list.
+//----------------------------------------------------------------------
+
+void
+IntrusiveList::Append(ListLink *link)
+{
+    InsertAfter(last, link);
+}
+
+void
+IntrusiveList::Prepend(ListLink *link)
+{
+    InsertAfter(NULL, link);
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList::Remove
+//      Remove the first link from the front of the list.
+// 
+// Returns:
+//	The item the link belongs to, NULL if nothing on the list.
+//----------------------------------------------------------------------
+
+void *
+IntrusiveList::Remove()
+{
+    return SortedRemove(NULL);  // Same as SortedRemove, but ignore the key
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList::RemoveLink
+//      Take a link off the list, wherever it is on it.
+//
+//	"link" is the link to remove; it must be on this list.
+//----------------------------------------------------------------------
+
+void
+IntrusiveList::RemoveLink(ListLink *link)
+{
+    ASSERT(link->list == this);
+
+    if (link->prev == NULL)
+	first = link->next;
+    else
+	link->prev->next = link->next;
+    if (link->next == NULL)
+	last = link->prev;
+    else
+	link->next->prev = link->prev;
+    link->prev = link->next = NULL;
+    link->list = NULL;
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList::Mapcar
+//	Apply a function to each item on the list.  The next link is
+//	looked up before calling "func", so "func" may take the item
+//	off the list.
+//
+//	"func" is the procedure to apply to each item on the list.
+//----------------------------------------------------------------------
+
+void
+IntrusiveList::Mapcar(VoidFunctionPtr func)
+{
+    ListLink *next;
+
+    for (ListLink *ptr = first; ptr != NULL; ptr = next) {
+	next = ptr->next;
+	DEBUG('l', "In mapcar, about to invoke %x(%x)\n", func, ptr->item);
+	(*func)((int)ptr->item);
+    }
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList::SortedInsert
+//      Put a link on the list, so that the links are sorted in
+//	increasing order by "sortKey".  Links with equal keys stay in
+//	the order they were inserted.
+//
+//	"link" is the link to put on the list.
+//	"sortKey" is the priority of the item.
+//----------------------------------------------------------------------
+
+void
+IntrusiveList::SortedInsert(ListLink *link, int sortKey)
+{
+    ListLink *ptr;
+
+    link->key = sortKey;
+    for (ptr = last; ptr != NULL && sortKey < ptr->key; ptr = ptr->prev)
+	;
+    InsertAfter(ptr, link);
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList::SortedRemove
+//      Remove the first link from the front of a sorted list.
+// 
+// Returns:
+//	The item the link belongs to, NULL if nothing on the list.
+//	Sets *keyPtr to the priority value of the removed item.
+//
+//	"keyPtr" is a pointer to the location in which to store the 
+//		priority of the removed item.
+//----------------------------------------------------------------------
+
+void *
+IntrusiveList::SortedRemove(int *keyPtr)
+{
+    ListLink *link = first;
+
+    if (IsEmpty()) 
+	return NULL;
+    if (keyPtr != NULL)
+        *keyPtr = link->key;
+    RemoveLink(link);
+    return link->item;
+}
+
+//----------------------------------------------------------------------
+// IntrusiveList::SortedFirst
+//      Look at the first item of a sorted list, without removing it.
+// 
+// Returns:
+//	The first item, NULL if nothing on the list.
+//	Sets *keyPtr to the priority value of the item, if there is one.
+//----------------------------------------------------------------------
+
+void *
+IntrusiveList::SortedFirst(int *keyPtr)
+{
+    if (IsEmpty()) 
+	return NULL;
+    if (keyPtr != NULL)
+        *keyPtr = first->key;
+    return first->item;
+}
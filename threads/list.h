@@ -32,6 +32,10 @@ class ListElement {
 				// NULL if this is the last
      int key;		    	// priority, for a sorted list
      void *item; 	    	// pointer to item on the list
+
+     static int numAllocated;	// how many list elements have ever been
+				// allocated, for measuring allocation
+				// traffic
 };
 
 // The following class defines a "list" -- a singly linked list of
@@ -64,4 +68,68 @@ class List {
     ListElement *last;		// Last element of list
 };
 
+class IntrusiveList;
+
+// The following class defines a link for an "intrusive" list -- one
+// whose links are embedded in the objects on the list, rather than
+// allocated separately.  An object has one ListLink for each list it
+// can be on at the same time; the owner sets "item" to point back to
+// itself.
+//
+// Kernel queues (the ready lists, synchronization wait queues, and
+// so on) use these, so that putting a thread on a queue, or taking
+// it off, never allocates memory, and any link can be taken off its
+// list in O(1) time.
+
+class ListLink {
+  public:
+    ListLink();			// initialize a link, not on any list
+
+    bool IsLinked() { return (list != NULL); }
+				// is the link on a list?
+
+    void *item;			// the object this link is embedded in
+    ListLink *prev;		// previous link on the list, NULL if first
+    ListLink *next;		// next link on the list, NULL if last
+    int key;			// priority, for a sorted list
+    IntrusiveList *list;	// the list we're on, NULL if none
+};
+
+// The following class defines a doubly-linked intrusive list.  It has
+// the same operations as List, except that they take the ListLink
+// for an item, and there is an O(1) RemoveLink.
+
+class IntrusiveList {
+  public:
+    IntrusiveList();		// initialize the list
+    ~IntrusiveList();		// de-allocate the list; it must be empty
+
+    void Prepend(ListLink *link); // Put link at the beginning of the list
+    void Append(ListLink *link); // Put link at the end of the list
+    void *Remove(); 	 	// Take link off the front of the list,
+				// and return its item
+    void RemoveLink(ListLink *link); // Take link off the list, wherever
+				// it is
+
+    void Mapcar(VoidFunctionPtr func);	// Apply "func" to every item
+					// on the list; "func" may take
+					// the item off the list
+    bool IsEmpty() { return (first == NULL); } // is the list empty?
+    ListLink *First() { return first; }	// first link, for walking the
+					// list through "next"; NULL if empty
+
+    // Routines to put/get links on/off list in order (sorted by key)
+    void SortedInsert(ListLink *link, int sortKey); // Put link into list
+    void *SortedRemove(int *keyPtr); 	  	// Remove first item from list
+    void *SortedFirst(int *keyPtr);		// Return first item, leaving
+						// it on the list
+
+  private:
+    ListLink *first;  		// Head of the list, NULL if list is empty
+    ListLink *last;		// Last link of list
+    
+    void InsertAfter(ListLink *prev, ListLink *link); // put link after
+				// prev, or at the front if prev is NULL
+};
+
 #endif // LIST_H
@@ -8,23 +8,41 @@
 //
 // 	Most of this file is not needed until later assignments.
 //
-// Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
+// Usage: nachos -d <debugflags> -rs <random seed #> -quantum <ticks>
+//		-tpool <free threads kept>
+//		-s -jit -x <nachos file> -c <consoleIn> <consoleOut>
 //		-f -cp <unix file> <nachos file>
 //		-p <nachos file> -r <nachos file> -l -D -t
 //              -n <network reliability> -m <machine id>
 //              -o <other machine id>
-//              -z
+//              -z -rp <fifo|clock|lru>
+//              -tlb <TLB entries> -tlbp <fifo|random|clock>
 //
 //    -d causes certain debugging messages to be printed (cf. utility.h)
 //    -rs causes Yield to occur at random (but repeatable) spots
+//    -quantum preempts the running thread once it has run for a time
+//	slice of this many ticks (doubled at each lower priority level)
+//    -tpool sets how many finished threads' control blocks and stacks
+//	are kept for reuse (default 16)
 //    -z prints the copyright message
 //
+//  THREADS
+//    -q 2 runs the synchronization benchmark (cf. threadtest.cc)
+//    -q 3 runs the fork benchmark
+//    -q 4 runs the elevator benchmark (cf. ElevatorTest.cc)
+//
 //  USER_PROGRAM
 //    -s causes user programs to be executed in single-step mode
+//    -jit runs user programs as translated basic blocks, rather than
+//	interpreting them one instruction at a time (ignored with -s)
 //    -x runs a user program
 //    -c tests the console
 //
+//  VM
+//    -rp chooses the page replacement policy (default fifo)
+//    -tlb sets the number of TLB entries (default TLBSize), with USE_TLB
+//    -tlbp chooses the TLB replacement policy (default fifo), with USE_TLB
+//
 //  FILESYS
 //    -f causes the physical disk to be formatted
 //    -cp copies a file from UNIX to Nachos
@@ -66,6 +84,9 @@ extern void MailTest(int networkID);
 extern void ThreadTest(int n);
 extern void LockTest(void);
 extern void ElevatorTest(int numFloors, int numPersons);
+extern void SynchBenchmark(int rounds);
+extern void ForkBenchmark(int numThreads);
+extern void ElevatorBenchmark(int numPersons);
 
 //----------------------------------------------------------------------
 // main
@@ -119,6 +140,13 @@ main(int argc, char **argv)
 	ElevatorTest(5,5);
 #endif
 
+    if (testnum == 2)
+	SynchBenchmark(10000);
+    else if (testnum == 3)
+	ForkBenchmark(10000);
+    else if (testnum == 4)
+	ElevatorBenchmark(200);
+
 #else
     ThreadTest();
 #endif
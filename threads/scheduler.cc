@@ -11,8 +11,18 @@
 //	end up calling FindNextToRun(), and that would put us in an 
 //	infinite loop.
 //
-// 	Very simple implementation -- no priorities, straight FIFO.
-//	Might need to be improved in later assignments.
+//	Threads are scheduled by a multi-level feedback queue (see
+//	scheduler.h): the thread at the front of the highest priority
+//	non-empty ready list runs next, round-robin within a level.
+//	Each level is a FIFO, so enqueue and dequeue are O(1).
+//
+//	Time is charged in simulated ticks, so it doesn't matter how
+//	often the timer fires.  A thread is charged whenever it gives up
+//	the CPU, so one that computes for long stretches is demoted even
+//	with no timer -- it just isn't preempted.  Every BoostQuanta
+//	quanta, all threads go back to level 0, so that demoted threads
+//	can't be starved; that is checked at each dispatch, as well as on
+//	each timer interrupt.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -24,28 +34,42 @@
 
 //----------------------------------------------------------------------
 // Scheduler::Scheduler
-// 	Initialize the list of ready but not running threads to empty.
+// 	Initialize the lists of ready but not running threads to empty.
 //----------------------------------------------------------------------
 
 Scheduler::Scheduler()
 { 
-    readyList = new List; 
+    for (int i = 0; i < NumPriorityLevels; i++)
+	readyList[i] = new IntrusiveList; 
+    baseQuantum = TimerTicks;
+    sliceStart = 0;
+    lastBoost = 0;
+#ifdef USER_PROGRAM
+    userRegsOwner = NULL;
+    loadedSpace = NULL;
+#endif
 } 
 
 //----------------------------------------------------------------------
 // Scheduler::~Scheduler
-// 	De-allocate the list of ready threads.
+// 	De-allocate the lists of ready threads.
 //----------------------------------------------------------------------
 
 Scheduler::~Scheduler()
 { 
-    delete readyList; 
+    for (int i = 0; i < NumPriorityLevels; i++)
+	delete readyList[i]; 
 } 
 
 //----------------------------------------------------------------------
 // Scheduler::ReadyToRun
 // 	Mark a thread as ready, but not running.
-//	Put it on the ready list, for later scheduling onto the CPU.
+//	Put it on the ready list for its level, for later scheduling onto
+//	the CPU.
+//
+//	A thread that was blocked is moved up a level, and gets a fresh
+//	quantum.  A running thread that gives up the CPU (Yield) is moved
+//	down a level if it has used up its quantum.
 //
 //	"thread" is the thread to be put on the ready list.
 //----------------------------------------------------------------------
@@ -53,16 +77,32 @@ Scheduler::~Scheduler()
 void
 Scheduler::ReadyToRun (Thread *thread)
 {
-    DEBUG('t', "Putting thread %s on ready list.\n", thread->getName());
+    if (thread->getStatus() == BLOCKED) {
+	if (thread->priority > 0)
+	    thread->priority--;
+	thread->ticksUsed = 0;
+    } else if (thread == currentThread) {
+	Charge(thread);
+	if (thread->ticksUsed >= Quantum(thread->priority)) {
+	    if (thread->priority < NumPriorityLevels - 1)
+		thread->priority++;
+	    thread->ticksUsed = 0;
+	}
+    }
+
+    DEBUG('t', "Putting thread %s on ready list %d.\n", thread->getName(),
+	  thread->EffectivePriority());
 
     thread->setStatus(READY);
-    readyList->Append((void *)thread);
+    readyList[thread->EffectivePriority()]->Append(&thread->queueLink);
 }
 
 //----------------------------------------------------------------------
 // Scheduler::FindNextToRun
 // 	Return the next thread to be scheduled onto the CPU.
 //	If there are no ready threads, return NULL.
+//
+//	First boost every thread back to level 0, if it's time.
 // Side effect:
 //	Thread is removed from the ready list.
 //----------------------------------------------------------------------
@@ -70,7 +110,143 @@ Scheduler::ReadyToRun (Thread *thread)
 Thread *
 Scheduler::FindNextToRun ()
 {
-    return (Thread *)readyList->Remove();
+    MaybeBoost();
+    for (int i = 0; i < NumPriorityLevels; i++)
+	if (!readyList[i]->IsEmpty())
+	    return (Thread *)readyList[i]->Remove();
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::RemoveThread
+// 	Take a thread off the ready lists, so that it will never be
+//	scheduled again; for instance, because it is being killed.
+//	Returns FALSE if the thread wasn't ready (it is running, or
+//	blocked on a synchronization variable).
+//
+//	"thread" is the thread to be removed.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::RemoveThread (Thread *thread)
+{
+    if (thread->getStatus() != READY)
+	return FALSE;
+    thread->queueLink.list->RemoveLink(&thread->queueLink);
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Reprioritize
+// 	A thread's effective priority has changed, because a thread
+//	waiting for a lock it holds has donated its priority, or the
+//	donation has ended.  If the thread is on a ready list, move it to
+//	the list for its new level.  (Running and blocked threads are
+//	put on the right list when they next become ready.)
+//
+//	"thread" is the thread whose priority changed.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Reprioritize (Thread *thread)
+{
+    if (thread->getStatus() != READY)
+	return;
+    thread->queueLink.list->RemoveLink(&thread->queueLink);
+    readyList[thread->EffectivePriority()]->Append(&thread->queueLink);
+}
+
+//----------------------------------------------------------------------
+// Scheduler::ShouldYield
+// 	Called from the timer interrupt handler.  Charge the running
+//	thread for the time it has used, boost every thread back to
+//	level 0 if it's time, and decide whether the running thread should
+//	be preempted: either because its quantum has run out, or because
+//	a thread at a higher priority is ready.
+//----------------------------------------------------------------------
+
+bool
+Scheduler::ShouldYield ()
+{
+    Charge(currentThread);
+    MaybeBoost();
+
+    if (currentThread->ticksUsed >= Quantum(currentThread->priority))
+	return TRUE;
+    for (int i = 0; i < currentThread->EffectivePriority(); i++)
+	if (!readyList[i]->IsEmpty())
+	    return TRUE;
+    return FALSE;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::SetQuantum
+// 	Set the time slice for threads at level 0 (each level below
+//	gets twice the slice of the one above).  Shorter slices mean
+//	more context switches, but less time waiting for the CPU.
+//
+//	"ticks" is the new slice length, in simulated ticks.
+//----------------------------------------------------------------------
+
+void
+Scheduler::SetQuantum (int ticks)
+{
+    ASSERT(ticks > 0);
+    baseQuantum = ticks;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Charge
+// 	Add the ticks since the running thread was dispatched (or last
+//	charged) to the time it has used at its level.
+//
+//	"thread" is the running thread.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Charge (Thread *thread)
+{
+    thread->ticksUsed += stats->totalTicks - sliceStart;
+    sliceStart = stats->totalTicks;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::MaybeBoost
+// 	Boost, if BoostQuanta level 0 quanta have gone by since the last
+//	time.
+//----------------------------------------------------------------------
+
+void
+Scheduler::MaybeBoost ()
+{
+    if (stats->totalTicks - lastBoost >= BoostQuanta * baseQuantum)
+	Boost();
+}
+
+//----------------------------------------------------------------------
+// Scheduler::Boost
+// 	Move every ready thread, and the running thread, back to level 0
+//	with a fresh quantum.  Threads keep their order, highest level
+//	first.  Blocked threads will be picked up when they next wake.
+//	Donated priorities are left alone; they can only be higher.
+//----------------------------------------------------------------------
+
+void
+Scheduler::Boost ()
+{
+    Thread *thread;
+
+    DEBUG('t', "Boosting all threads to level 0.\n");
+
+    for (int i = 1; i < NumPriorityLevels; i++)
+	while ((thread = (Thread *)readyList[i]->Remove()) != NULL) {
+	    thread->priority = 0;
+	    thread->ticksUsed = 0;
+	    readyList[0]->Append(&thread->queueLink);
+	}
+    currentThread->priority = 0;
+    currentThread->ticksUsed = 0;
+    lastBoost = stats->totalTicks;
 }
 
 //----------------------------------------------------------------------
@@ -79,6 +255,12 @@ Scheduler::FindNextToRun ()
 //	and load the state of the new thread, by calling the machine
 //	dependent context switch routine, SWITCH.
 //
+//	A user program's registers and page table are left in the
+//	machine when its thread is switched out, and only saved when
+//	another user program needs the machine.  Switching to a kernel
+//	thread and back, or between threads of the same program, then
+//	costs no copying at all.
+//
 //      Note: we assume the state of the previously running thread has
 //	already been changed from running to blocked or ready (depending).
 // Side effect:
@@ -93,17 +275,18 @@ Scheduler::Run (Thread *nextThread)
     Thread *oldThread = currentThread;
     
 #ifdef USER_PROGRAM			// ignore until running user programs 
-    if (currentThread->space != NULL) {	// if this thread is a user program,
-        currentThread->SaveUserState(); // save the user's CPU registers
-	currentThread->space->SaveState();
-    }
+    if (currentThread->space != NULL)	// if this thread is a user program,
+	userRegsOwner = currentThread;	// its registers stay in the machine
+					// until someone else needs them
 #endif
     
     oldThread->CheckOverflow();		    // check if the old thread
 					    // had an undetected stack overflow
 
+    stats->numContextSwitches++;
     currentThread = nextThread;		    // switch to the next thread
     currentThread->setStatus(RUNNING);      // nextThread is now running
+    sliceStart = stats->totalTicks;	    // and starts being charged
     
     DEBUG('t', "Switching from thread \"%s\" to thread \"%s\"\n",
 	  oldThread->getName(), nextThread->getName());
@@ -128,20 +311,92 @@ Scheduler::Run (Thread *nextThread)
     
 #ifdef USER_PROGRAM
     if (currentThread->space != NULL) {		// if there is an address space
-        currentThread->RestoreUserState();     // to restore, do it.
-	currentThread->space->RestoreState();
+	if (userRegsOwner != currentThread) {	// to restore, do it.
+	    if (userRegsOwner != NULL)
+		userRegsOwner->SaveUserState();
+	    currentThread->RestoreUserState();
+	    userRegsOwner = currentThread;
+	} else
+	    stats->numRegisterRestoresElided++;
+	LoadSpace(currentThread->space);
     }
 #endif
 }
 
+#ifdef USER_PROGRAM
+//----------------------------------------------------------------------
+// Scheduler::LoadSpace
+// 	Have the machine translate addresses through "space", saving the
+//	state of the address space it was using, unless it is already
+//	using "space".
+//
+//	"space" is the address space to load.
+//----------------------------------------------------------------------
+
+void
+Scheduler::LoadSpace (AddrSpace *space)
+{
+    if (space == loadedSpace) {
+	stats->numSpaceSwitchesElided++;
+	return;
+    }
+    if (loadedSpace != NULL)
+	loadedSpace->SaveState();
+    space->RestoreState();
+    loadedSpace = space;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::ClaimUserRegisters
+// 	The kernel is about to put a fresh set of user registers into the
+//	machine for the current thread, without going through Run -- a
+//	forked thread starting, or a program being loaded.  Whoever's
+//	registers are still in the machine must be saved first, and the
+//	current thread becomes their owner.
+//----------------------------------------------------------------------
+
+void
+Scheduler::ClaimUserRegisters ()
+{
+    if (userRegsOwner != NULL && userRegsOwner != currentThread)
+	userRegsOwner->SaveUserState();
+    userRegsOwner = currentThread;
+}
+
+//----------------------------------------------------------------------
+// Scheduler::ForgetSpace, Scheduler::ForgetThread
+// 	An address space, or a thread, is about to be deleted; stop
+//	remembering that its state is loaded in the machine.  (Otherwise
+//	a new one allocated at the same address would look loaded.)
+//----------------------------------------------------------------------
+
+void
+Scheduler::ForgetSpace (AddrSpace *space)
+{
+    if (space == loadedSpace)
+	loadedSpace = NULL;
+}
+
+void
+Scheduler::ForgetThread (Thread *thread)
+{
+    if (thread == userRegsOwner)
+	userRegsOwner = NULL;
+}
+#endif
+
 //----------------------------------------------------------------------
 // Scheduler::Print
 // 	Print the scheduler state -- in other words, the contents of
-//	the ready list.  For debugging.
+//	the ready lists.  For debugging.
 //----------------------------------------------------------------------
 void
 Scheduler::Print()
 {
     printf("Ready list contents:\n");
-    readyList->Mapcar((VoidFunctionPtr) ThreadPrint);
+    for (int i = 0; i < NumPriorityLevels; i++) {
+	printf("  level %d: ", i);
+	readyList[i]->Mapcar((VoidFunctionPtr) ThreadPrint);
+	printf("\n");
+    }
 }
@@ -1,6 +1,14 @@
 // scheduler.h 
 //	Data structures for the thread dispatcher and scheduler.
-//	Primarily, the list of threads that are ready to run.
+//	Primarily, the lists of threads that are ready to run.
+//
+//	The scheduler is a multi-level feedback queue: there is one
+//	FIFO ready list per priority level, and a thread's level
+//	changes with how it uses the CPU.  A thread that uses up its
+//	quantum is moved down a level (where quanta are longer); a
+//	thread that blocks is moved up a level when it is woken.  Every
+//	so often all threads are boosted back to the top level, so that
+//	CPU-bound threads can't be starved forever.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -12,6 +20,10 @@
 #include "copyright.h"
 #include "list.h"
 #include "thread.h"
+#include "stats.h"
+
+#define BoostQuanta	50		// how many level 0 quanta between
+					// moving every thread back to level 0
 
 // The following class defines the scheduler/dispatcher abstraction -- 
 // the data structures and operations needed to keep track of which 
@@ -23,14 +35,51 @@ class Scheduler {
     ~Scheduler();			// De-allocate ready list
 
     void ReadyToRun(Thread* thread);	// Thread can be dispatched.
-    Thread* FindNextToRun();		// Dequeue first thread on the ready 
-					// list, if any, and return thread.
+    Thread* FindNextToRun();		// Dequeue first thread on the highest
+					// priority ready list, if any, and
+					// return thread.
+    bool RemoveThread(Thread* thread);	// Take thread off the ready lists;
+					// FALSE if it wasn't on them
+    void Reprioritize(Thread* thread);	// thread's effective priority has
+					// changed; requeue it if it's ready
     void Run(Thread* nextThread);	// Cause nextThread to start running
-    void Print();			// Print contents of ready list
+    bool ShouldYield();			// Called on each timer interrupt;
+					// TRUE if currentThread should give
+					// up the CPU
+    void SetQuantum(int ticks);		// Set the level 0 time slice
+    int GetQuantum() { return baseQuantum; }
+    void Print();			// Print contents of ready lists
+
+#ifdef USER_PROGRAM
+    void LoadSpace(AddrSpace* space);	// Make "space" the address space
+					// the machine translates through
+    void ClaimUserRegisters();		// Save whoever's user registers are
+					// in the machine; currentThread is
+					// about to load its own
+    void ForgetSpace(AddrSpace* space);	// "space" is being deleted
+    void ForgetThread(Thread* thread);	// "thread" is being deleted
+#endif
     
   private:
-    List *readyList;  		// queue of threads that are ready to run,
-				// but not running
+    IntrusiveList *readyList[NumPriorityLevels]; // queues of threads that are ready
+				// to run, but not running, one per level
+    int baseQuantum;		// time slice at level 0; it doubles at
+				// each level below
+    int sliceStart;		// when currentThread was dispatched
+    int lastBoost;		// when all threads were last moved to level 0
+#ifdef USER_PROGRAM
+    Thread *userRegsOwner;	// the thread whose user registers are in
+				// the machine, and not yet saved; NULL if
+				// none
+    AddrSpace *loadedSpace;	// the address space whose page table the
+				// machine is using; NULL if none
+#endif
+
+    int Quantum(int level) { return baseQuantum << level; }
+    void Charge(Thread* thread); // charge thread for the CPU time it has
+				// used since it was dispatched
+    void Boost();		// move every thread back to level 0
+    void MaybeBoost();		// ... if it has been long enough
 };
 
 #endif // SCHEDULER_H
@@ -1,8 +1,7 @@
 // synch.cc 
-//	Routines for synchronizing threads.  Three kinds of
-//	synchronization routines are defined here: semaphores, locks 
-//   	and condition variables (the implementation of the last two
-//	are left to the reader).
+//	Routines for synchronizing threads.  Four kinds of
+//	synchronization routines are defined here: semaphores, locks,
+//	condition variables, and readers-writer locks.
 //
 // Any implementation of a synchronization routine needs some
 // primitive atomic operation.  We assume Nachos is running on
@@ -37,7 +36,7 @@ Semaphore::Semaphore(const char* debugName, int initialValue)
 {
     name = debugName;
     value = initialValue;
-    queue = new List;
+    queue = new IntrusiveList;
 }
 
 //----------------------------------------------------------------------
@@ -51,6 +50,42 @@ Semaphore::~Semaphore()
     delete queue;
 }
 
+//----------------------------------------------------------------------
+// Deadline, SleepOn
+// 	Helpers for the timed waits.  Deadline turns a "timeout" into the
+//	time to give up.  SleepOn puts the current thread on "queue" and
+//	sleeps until someone wakes it, or until "deadline" comes, if it
+//	isn't WaitForever.  It returns FALSE if we timed out; the alarm
+//	has then already taken us off "queue".  A deadline that has
+//	already passed (a negative timeout, say) times out at once,
+//	without our being queued at all.
+//
+//	Interrupts must be disabled.
+//----------------------------------------------------------------------
+
+static int
+Deadline(int timeout)
+{
+    if (timeout == WaitForever)
+	return WaitForever;
+    return stats->totalTicks + timeout;
+}
+
+static bool
+SleepOn(IntrusiveList *queue, int deadline)
+{
+    if (deadline != WaitForever && deadline <= stats->totalTicks)
+	return FALSE;
+    currentThread->timedOut = FALSE;
+    queue->Append(&currentThread->queueLink);
+    if (deadline != WaitForever)
+	alarmClock->SetTimeout(currentThread, deadline);
+    currentThread->Sleep();
+    if (deadline != WaitForever)
+	alarmClock->CancelTimeout(currentThread);
+    return !currentThread->timedOut;
+}
+
 //----------------------------------------------------------------------
 // Semaphore::P
 // 	Wait until semaphore value > 0, then decrement.  Checking the
@@ -59,21 +94,32 @@ Semaphore::~Semaphore()
 //
 //	Note that Thread::Sleep assumes that interrupts are disabled
 //	when it is called.
+//
+//	"timeout" is how many ticks to wait: WaitForever, or 0 to not
+//	wait at all.  Return TRUE if we decremented the value, FALSE if
+//	we ran out of time first.
 //----------------------------------------------------------------------
 
-void
-Semaphore::P()
+bool
+Semaphore::P(int timeout)
 {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	// disable interrupts
+    int deadline = Deadline(timeout);
+    bool acquired = TRUE;
     
     while (value == 0) { 			// semaphore not available
-	queue->Append((void *)currentThread);	// so go to sleep
-	currentThread->Sleep();
+	if (deadline != WaitForever && stats->totalTicks >= deadline) {
+	    acquired = FALSE;			// out of time
+	    break;
+	}
+	(void) SleepOn(queue, deadline);	// so go to sleep
     } 
-    value--; 					// semaphore available, 
+    if (acquired)
+	value--; 				// semaphore available, 
 						// consume its value
     
     (void) interrupt->SetLevel(oldLevel);	// re-enable interrupts
+    return acquired;
 }
 
 //----------------------------------------------------------------------
@@ -101,12 +147,48 @@ Semaphore::V()
 // Note -- without a correct implementation of Condition::Wait(), 
 // the test case in the network assignment won't work!
 
+//----------------------------------------------------------------------
+// Lock::Lock, Lock::Acquire, Lock::Release
+// 	Locks implement priority inheritance: a thread that has to wait
+//	for a lock lends its priority to the holder (and to whoever holds
+//	the lock the holder is waiting for, and so on), so that a high
+//	priority thread isn't held up behind a low priority one that
+//	never gets the CPU.  When the holder releases the lock, its
+//	priority drops back to what the waiters for the locks it still
+//	holds call for, and the highest priority waiter gets the lock.
+//
+//	The lock is handed over directly: the waiter is made the holder
+//	before it is woken, so no other thread can take the lock in
+//	between, and the waiter doesn't have to check again.
+//----------------------------------------------------------------------
+
+// Recompute the priority lent to "thread" by waiters for its locks
+static void
+UpdateInheritedPriority(Thread *thread)
+{
+    int level = NumPriorityLevels;
+
+    for (ListLink *l = thread->heldLocks.First(); l != NULL; l = l->next) {
+	int waiter = ((Lock *) l->item)->BestWaiterPriority();
+	if (waiter < level)
+	    level = waiter;
+    }
+    if (level != thread->inheritedPriority) {
+	thread->inheritedPriority = level;
+	scheduler->Reprioritize(thread);
+    }
+}
+
 Lock::Lock(const char* debugName) {
     name = debugName;
     free = true;
-    queue = new List;
+    currentHolder = NULL;
+    queue = new IntrusiveList;
+    heldLink.item = this;
 }
 Lock::~Lock() {
+    if (currentHolder != NULL)
+        currentHolder->heldLocks.RemoveLink(&heldLink);
     delete queue;
 }
 
@@ -115,12 +197,15 @@ void Lock::Acquire() {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);	// disable interrupts
 
     // Check if lock is free
-    while (free == false){
-        queue->Append((void *)currentThread);	// so go to sleep
-	    currentThread->Sleep();
+    if (free == false){
+        AddWaiter(currentThread);		// so go to sleep
+        currentThread->Sleep();
+        ASSERT(currentHolder == currentThread);	// Release handed it to us
+    } else {
+        free = false;
+        currentHolder = currentThread;
+        currentThread->heldLocks.Append(&heldLink);
     }
-    free = false;
-    currentHolder = currentThread;
 
     (void) interrupt->SetLevel(oldLevel);	// re-enable interrupts
 }
@@ -130,12 +215,30 @@ void Lock::Release() {
 
     // check if thread has lock ... isHeldByCurrentThread ?
     if(isHeldByCurrentThread()){
-        // If yes, release the lock and wakeup 1 of the waiting threads in queue
-        free = true;
+        // If yes, release the lock, give back any priority it lent
+        // us, and hand it to the highest priority waiting thread
         currentHolder = NULL; 
-        Thread *wakeUp = (Thread*) queue->Remove();
+        currentThread->heldLocks.RemoveLink(&heldLink);
+        UpdateInheritedPriority(currentThread);
+
+        Thread *wakeUp = NULL;
+        for (ListLink *l = queue->First(); l != NULL; l = l->next) {
+            Thread *waiter = (Thread *) l->item;
+            if (wakeUp == NULL
+                  || waiter->EffectivePriority() < wakeUp->EffectivePriority())
+                wakeUp = waiter;
+        }
         if(wakeUp != NULL){
+            queue->RemoveLink(&wakeUp->queueLink);
+            wakeUp->waitingOn = NULL;
+            currentHolder = wakeUp;
+            wakeUp->heldLocks.Append(&heldLink);
+            UpdateInheritedPriority(wakeUp);	// the other waiters now
+						// lend it their priority
+            stats->numLockHandoffs++;
             scheduler->ReadyToRun(wakeUp);
+        } else {
+            free = true;
         }
         
     }
@@ -152,28 +255,82 @@ bool Lock::isHeldByCurrentThread() {
 
 }
 
+int Lock::BestWaiterPriority() {
+
+    int level = NumPriorityLevels;
+    for (ListLink *l = queue->First(); l != NULL; l = l->next) {
+        Thread *waiter = (Thread *) l->item;
+        if (waiter->EffectivePriority() < level)
+            level = waiter->EffectivePriority();
+    }
+    return level;
+}
+
+void Lock::AddWaiter(Thread *thread) {
+
+    ASSERT(interrupt->getLevel() == IntOff);
+    ASSERT(!free);
+    thread->waitingOn = this;
+    DonatePriority(thread->EffectivePriority());
+    queue->Append(&thread->queueLink);
+}
+
+void Lock::DonatePriority(int level) {
+
+    // Walk the chain: our holder, the holder of the lock it is
+    // waiting for, and so on, until someone already runs at "level"
+    Lock *lock = this;
+    while (lock != NULL && lock->currentHolder != NULL) {
+        Thread *holder = lock->currentHolder;
+        if (holder->EffectivePriority() <= level) break;
+        holder->inheritedPriority = level;
+        scheduler->Reprioritize(holder);
+        lock = holder->waitingOn;
+    }
+}
+
 Condition::Condition(const char* debugName) {
     name = debugName; // init
-    queue =  new List;
+    queue = new IntrusiveList;
+    morphing = true;
 }
 Condition::~Condition() {
     delete queue;
 }
 
-void Condition::Wait(Lock* conditionLock) {
+// Wait until signalled, or for at most "timeout" ticks (WaitForever
+// to wait as long as it takes); TRUE if we were signalled
+bool Condition::Wait(Lock* conditionLock, int timeout) {
 
     // check if calling thread holds the lock
     ASSERT(conditionLock->isHeldByCurrentThread());
+    if (timeout == 0)
+        return FALSE;                   // no time to be signalled in
     
     IntStatus oldLevel = interrupt->SetLevel(IntOff);// disable interrupts
     conditionLock->Release();
     // put self in the queue of waiting threads
-    queue->Append((void *)currentThread);
-    currentThread->Sleep();
-    // Re-acquire the lock
-    conditionLock-> Acquire();
+    bool signalled = SleepOn(queue, Deadline(timeout));
+    // Re-acquire the lock, unless we were moved to its queue and it
+    // has already been handed to us
+    if (!conditionLock->isHeldByCurrentThread())
+        conditionLock->Acquire();
     (void) interrupt->SetLevel(oldLevel);
-    
+    return signalled;
+}
+
+// Wake a waiter: either put it in line for the lock, or on the ready list
+void Condition::WakeUp(Thread* thread, Lock* conditionLock) {
+
+    // It was signalled in time; once it's on the lock's queue, the
+    // alarm mustn't take it off
+    alarmClock->CancelTimeout(thread);
+    if (morphing) {
+        conditionLock->AddWaiter(thread);
+        stats->numWaitsMorphed++;
+    } else {
+        scheduler->ReadyToRun(thread);
+    }
 }
 void Condition::Signal(Lock* conditionLock) {
 
@@ -182,7 +339,7 @@ void Condition::Signal(Lock* conditionLock) {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);// disable interrupts
     Thread *nextThread = (Thread *)queue->Remove();
     if(nextThread!=NULL){
-        scheduler->ReadyToRun(nextThread);
+        WakeUp(nextThread, conditionLock);
     }
     (void) interrupt->SetLevel(oldLevel);
 
@@ -194,8 +351,207 @@ void Condition::Broadcast(Lock* conditionLock) {
     IntStatus oldLevel = interrupt->SetLevel(IntOff);// disable interrupts
     Thread *nextThread = (Thread *)queue->Remove();
     while(nextThread!=NULL){
-        scheduler->ReadyToRun(nextThread);
+        WakeUp(nextThread, conditionLock);
         nextThread = (Thread *)queue->Remove();
     } 
     (void) interrupt->SetLevel(oldLevel);
  }
+
+//----------------------------------------------------------------------
+// RWLock::RWLock
+// 	Initialize a readers-writer lock, so that it is FREE.
+//
+//	"debugName" is an arbitrary name, useful for debugging.
+//	"lockPolicy" says whether waiting readers or writers go first.
+//----------------------------------------------------------------------
+
+RWLock::RWLock(const char* debugName, RWLockPolicy lockPolicy)
+{
+    name = debugName;
+    policy = lockPolicy;
+    readers = 0;
+    writer = NULL;
+    readQueue = new IntrusiveList;
+    writeQueue = new IntrusiveList;
+}
+
+//----------------------------------------------------------------------
+// RWLock::~RWLock
+// 	De-allocate a readers-writer lock, when no longer needed.  Assume
+//	no one is still holding or waiting for it.
+//----------------------------------------------------------------------
+
+RWLock::~RWLock()
+{
+    ASSERT(readers == 0 && writer == NULL);
+    delete readQueue;
+    delete writeQueue;
+}
+
+//----------------------------------------------------------------------
+// RWLock::CanRead
+// 	Can a thread that has just arrived read right now?  Not if a
+//	writer holds the lock, nor, under PreferWriters, if one is waiting
+//	for it.
+//----------------------------------------------------------------------
+
+bool
+RWLock::CanRead()
+{
+    return writer == NULL
+	&& (policy == PreferReaders || writeQueue->IsEmpty());
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireRead
+// 	Wait until no writer holds (or, under PreferWriters, is waiting
+//	for) the lock, then hold it for reading.
+//
+//	"timeout" is how many ticks to wait: WaitForever, or 0 to not
+//	wait at all.  Return TRUE if we got the lock.
+//----------------------------------------------------------------------
+
+bool
+RWLock::AcquireRead(int timeout)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    bool acquired = TRUE;
+
+    if (CanRead())
+	readers++;
+    else
+	acquired = Wait(readQueue, timeout);	// if it returns TRUE,
+						// we've been counted
+    (void) interrupt->SetLevel(oldLevel);
+    return acquired;
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReleaseRead
+// 	Give up a read hold on the lock.  The last reader out hands the
+//	lock to a waiting writer, if there is one.
+//----------------------------------------------------------------------
+
+void
+RWLock::ReleaseRead()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(readers > 0);
+    readers--;
+    if (readers == 0)
+	GrantWaiters();
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::AcquireWrite
+// 	Wait until no one holds the lock, then hold it for writing.
+//
+//	"timeout" is how many ticks to wait: WaitForever, or 0 to not
+//	wait at all.  Return TRUE if we got the lock.
+//----------------------------------------------------------------------
+
+bool
+RWLock::AcquireWrite(int timeout)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    bool acquired = TRUE;
+
+    ASSERT(writer != currentThread);
+    if (writer == NULL && readers == 0)
+	writer = currentThread;
+    else
+	acquired = Wait(writeQueue, timeout);	// if it returns TRUE,
+						// we're the writer
+    (void) interrupt->SetLevel(oldLevel);
+    return acquired;
+}
+
+//----------------------------------------------------------------------
+// RWLock::ReleaseWrite
+// 	Give up the write hold on the lock, handing it to whoever is
+//	waiting.  Only the writer may release it.
+//----------------------------------------------------------------------
+
+void
+RWLock::ReleaseWrite()
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+
+    ASSERT(writer == currentThread);
+    writer = NULL;
+    GrantWaiters();
+    (void) interrupt->SetLevel(oldLevel);
+}
+
+//----------------------------------------------------------------------
+// RWLock::isWriteHeldByCurrentThread
+// 	Does the current thread hold the lock for writing?  (Readers
+//	aren't tracked individually, so there is no test for them.)
+//----------------------------------------------------------------------
+
+bool
+RWLock::isWriteHeldByCurrentThread()
+{
+    return writer == currentThread;
+}
+
+//----------------------------------------------------------------------
+// RWLock::Wait
+// 	Wait on "queue" until GrantWaiters gives us the lock, or until
+//	"timeout" ticks have gone by.  Return TRUE if we got the lock.
+//
+//	A thread that times out has already been taken off "queue" by
+//	the alarm.  If it was a writer at the head of writeQueue, the
+//	readers held back behind it may now go, so we look again.
+//
+//	Interrupts must be disabled.
+//----------------------------------------------------------------------
+
+bool
+RWLock::Wait(IntrusiveList *queue, int timeout)
+{
+    if (timeout == 0)
+	return FALSE;			// just trying
+
+    if (!SleepOn(queue, Deadline(timeout))) {
+	DEBUG('t', "Thread \"%s\" timed out on rwlock \"%s\"\n",
+	      currentThread->getName(), name);
+	GrantWaiters();
+	return FALSE;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// RWLock::GrantWaiters
+// 	The lock has been released (or a waiter gave up); hand it to the
+//	threads that are next in line, according to the policy: either
+//	one writer, or every waiting reader.  The threads we wake
+//	already hold the lock when they run.
+//
+//	Interrupts must be disabled.
+//----------------------------------------------------------------------
+
+void
+RWLock::GrantWaiters()
+{
+    Thread *thread;
+
+    if (writer != NULL)
+	return;
+    if (policy == PreferWriters || readQueue->IsEmpty()) {
+	if (!writeQueue->IsEmpty()) {
+	    if (readers == 0) {		// writer goes next
+		writer = (Thread *)writeQueue->Remove();
+		scheduler->ReadyToRun(writer);
+	    }
+	    return;			// else wait for the readers to drain
+	}
+    }
+    while ((thread = (Thread *)readQueue->Remove()) != NULL) {
+	readers++;			// let every reader in
+	scheduler->ReadyToRun(thread);
+    }
+}
@@ -1,11 +1,10 @@
 // synch.h 
 //	Data structures for synchronizing threads.
 //
-//	Three kinds of synchronization are defined here: semaphores,
-//	locks, and condition variables.  The implementation for
-//	semaphores is given; for the latter two, only the procedure
-//	interface is given -- they are to be implemented as part of 
-//	the first assignment.
+//	Four kinds of synchronization are defined here: semaphores,
+//	locks, condition variables, and readers-writer locks.  All
+//	four are implemented in synch.cc, on top of the thread
+//	scheduler.
 //
 //	Note that all the synchronization objects take a "name" as
 //	part of the initialization.  This is solely for debugging purposes.
@@ -23,6 +22,13 @@
 
 class Thread;
 
+// Semaphores, condition variables, and readers-writer locks can also be
+// waited on for a limited time: the timed forms of P, Wait, and the
+// RWLock acquires take a number of ticks to wait, and return FALSE if
+// that time went by first.  "timeout" 0 means don't wait at all.
+
+#define WaitForever	-1		// timeout for an untimed wait
+
 // The following class defines a "semaphore" whose value is a non-negative
 // integer.  The semaphore has only two operations P() and V():
 //
@@ -44,13 +50,17 @@ class Semaphore {
     ~Semaphore();   					// de-allocate semaphore
     const char* getName() { return name;}			// debugging assist
     
-    void P();	 // these are the only operations on a semaphore
-    void V();	 // they are both *atomic*
+    void P() { (void) P(WaitForever); }
+			// these are the only operations on a semaphore
+    void V();	 	// they are both *atomic*
+
+    bool P(int timeout);	// give up after "timeout" ticks; TRUE if
+				// we decremented the value
     
   private:
     const char* name;        // useful for debugging
     int value;         // semaphore value, always >= 0
-    List *queue;       // threads waiting in P() for the value to be > 0
+    IntrusiveList *queue; // threads waiting in P() for the value to be > 0
 };
 
 // The following class defines a "lock".  A lock can be BUSY or FREE.
@@ -78,14 +88,26 @@ class Lock {
 					// checking in Release, and in
 					// Condition variable ops below.
 
+    int BestWaiterPriority();		// the highest effective priority
+					// of the threads waiting for the
+					// lock, NumPriorityLevels if none
+    void AddWaiter(Thread *thread);	// queue a sleeping thread for the
+					// lock, as if it had called Acquire
+					// (for Condition wait morphing)
+
   private:
     const char* name;				// for debugging
     // plus some other stuff you'll need to define
     //We need a queue, similar to that of Semaphore 
-    List *queue;       // threads waiting on lock to become free
+    IntrusiveList *queue; // threads waiting on lock to become free
     //Need to know if the lock is free(avaliable)
     bool free; //Checks if lock is free
     Thread *currentHolder; //thread that currently holds the lock
+    ListLink heldLink;		// on currentHolder's list of held locks
+
+    void DonatePriority(int level);	// lend "level" to the holder, and
+					// on down the chain of locks it
+					// is waiting for
 };
 
 // The following class defines a "condition variable".  A condition
@@ -119,6 +141,12 @@ class Lock {
 // The consequence of using Mesa-style semantics is that some other thread
 // can acquire the lock, and change data structures, before the woken
 // thread gets a chance to run.
+//
+// By default, a condition "morphs" waits: rather than putting the
+// woken thread on the ready list, only to have it find the lock still
+// held by the signaller and go back to sleep, Signal and Broadcast move
+// it straight onto the lock's queue.  The lock is then handed to it
+// when it's released.  The semantics are the same.
 
 class Condition {
   public:
@@ -127,7 +155,8 @@ class Condition {
     ~Condition();			// deallocate the condition
     const char* getName() { return (name); }
     
-    void Wait(Lock *conditionLock); 	// these are the 3 operations on 
+    void Wait(Lock *conditionLock) { (void) Wait(conditionLock, WaitForever); }
+    					// these are the 3 operations on 
 					// condition variables; releasing the 
 					// lock and going to sleep are 
 					// *atomic* in Wait()
@@ -135,9 +164,77 @@ class Condition {
     void Broadcast(Lock *conditionLock);// the currentThread for all of 
 					// these operations
 
+    bool Wait(Lock *conditionLock, int timeout);
+					// give up after "timeout" ticks;
+					// TRUE if we were signalled.  The
+					// lock is re-acquired either way.
+
+    void SetWaitMorphing(bool on) { morphing = on; }
+					// wake waiters onto the lock's queue
+					// (the default), or the ready list
+
   private:
     const char* name;
-    List *queue;  
+    IntrusiveList *queue; // threads waiting in Wait()
+    bool morphing;		// move woken waiters to the lock's queue?
+
+    void WakeUp(Thread *thread, Lock *conditionLock);
     // plus some other stuff you'll need to define
 };
+
+// The following class defines a "readers-writer lock".  Any number of
+// threads may hold it for reading at once, but a thread holding it for
+// writing holds it alone:
+//
+//	AcquireRead/ReleaseRead -- shared access, for looking at the
+//		data the lock protects
+//
+//	AcquireWrite/ReleaseWrite -- exclusive access, for changing it
+//
+// When both readers and writers are waiting, the lock's policy decides
+// who goes first.  PreferWriters holds back new readers as soon as a
+// writer is waiting, so that a steady stream of readers can't starve
+// the writers; PreferReaders lets readers in whenever no writer holds
+// the lock, which gets the most concurrency but can starve writers.
+//
+// The acquire operations also come in "try" (don't wait) and timed
+// (wait at most "timeout" ticks) forms, which return FALSE if the lock
+// couldn't be had.  A waiting thread is granted the lock directly by the
+// thread that releases it, the same way Lock hands itself to a waiter.
+
+enum RWLockPolicy { PreferWriters, PreferReaders };
+
+class RWLock {
+  public:
+    RWLock(const char* debugName, RWLockPolicy lockPolicy = PreferWriters);
+					// initialize lock to be FREE
+    ~RWLock();				// deallocate lock
+    const char* getName() { return name; }	// debugging assist
+
+    void AcquireRead() { (void) AcquireRead(WaitForever); }
+    void ReleaseRead();
+    void AcquireWrite() { (void) AcquireWrite(WaitForever); }
+    void ReleaseWrite();
+
+    bool TryAcquireRead() { return AcquireRead(0); }
+    bool TryAcquireWrite() { return AcquireWrite(0); }
+    bool AcquireRead(int timeout);	// wait at most "timeout" ticks;
+    bool AcquireWrite(int timeout);	// TRUE if we got the lock
+
+    bool isWriteHeldByCurrentThread();	// true if the current thread
+					// holds it for writing
+
+  private:
+    const char* name;			// for debugging
+    RWLockPolicy policy;		// who goes first when both wait
+    int readers;			// how many threads hold it for reading
+    Thread *writer;			// thread holding it for writing, if any
+    IntrusiveList *readQueue;		// threads waiting in AcquireRead
+    IntrusiveList *writeQueue;		// threads waiting in AcquireWrite
+
+    bool CanRead();			// may a newcomer read right now?
+    bool Wait(IntrusiveList *queue, int timeout);
+					// sleep until granted or timed out
+    void GrantWaiters();		// hand the lock to whoever is next
+};
 #endif // SYNCH_H
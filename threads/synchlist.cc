@@ -14,6 +14,7 @@
 
 #include "copyright.h"
 #include "synchlist.h"
+#include "system.h"
 
 //----------------------------------------------------------------------
 // SynchList::SynchList
@@ -63,20 +64,30 @@ SynchList::Append(void *item)
 // SynchList::Remove
 //      Remove an "item" from the beginning of the list.  Wait if
 //	the list is empty.
+//
+//	"timeout" is how many ticks to wait: WaitForever, or 0 to not
+//	wait at all.
 // Returns:
-//	The removed item. 
+//	The removed item, or NULL if the list was still empty when
+//	we ran out of time.
 //----------------------------------------------------------------------
 
 void *
-SynchList::Remove()
+SynchList::Remove(int timeout)
 {
     void *item;
+    int deadline = stats->totalTicks + timeout;
 
     lock->Acquire();			// enforce mutual exclusion
-    while (list->IsEmpty())
-	listEmpty->Wait(lock);		// wait until list isn't empty
+    while (list->IsEmpty()) {		// wait until list isn't empty
+	if (timeout == WaitForever)
+	    listEmpty->Wait(lock);
+	else if (deadline <= stats->totalTicks
+		 || !listEmpty->Wait(lock, deadline - stats->totalTicks))
+	    break;			// out of time
+    }
     item = list->Remove();
-    ASSERT(item != NULL);
+    ASSERT(item != NULL || timeout != WaitForever);
     lock->Release();
     return item;
 }
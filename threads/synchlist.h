@@ -28,8 +28,11 @@ class SynchList {
 
     void Append(void *item);	// append item to the end of the list,
 				// and wake up any thread waiting in remove
-    void *Remove();		// remove the first item from the front of
+    void *Remove() { return Remove(WaitForever); }
+				// remove the first item from the front of
 				// the list, waiting if the list is empty
+    void *Remove(int timeout);	// ... but for at most "timeout" ticks;
+				// NULL if nothing turned up in time
 				// apply function to every item in the list
     void Mapcar(VoidFunctionPtr func);
 
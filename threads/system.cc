@@ -18,6 +18,8 @@ Interrupt *interrupt;			// interrupt status
 Statistics *stats;			// performance metrics
 Timer *timer;				// the hardware timer device,
 					// for invoking context switches
+Alarm *alarmClock;			// the software alarm clock, for
+					// sleeping until a given time
 
 #ifdef FILESYS_NEEDED
 FileSystem  *fileSystem;
@@ -32,7 +34,18 @@ SynchDisk   *synchDisk;
 Machine *machine;	// user program memory and registers
 MemoryManager *mm;
 Lock *mmLock;
+Lock *joinLock;
+TextCache *textCache;
 PCBManager *pcbManager;
+SynchConsole *synchConsole;
+#endif
+
+#ifdef VM
+Pager *pager;
+#endif
+
+#ifdef USE_TLB
+TLBManager *tlbManager;
 #endif
 
 #ifdef NETWORK
@@ -43,14 +56,21 @@ PostOffice *postOffice;
 // External definition, to allow us to take a pointer to this function
 extern void Cleanup();
 
+static bool randomYield = FALSE;	// -rs: switch threads at random
+					// (but repeatable) spots
+
 
 //----------------------------------------------------------------------
 // TimerInterruptHandler
 // 	Interrupt handler for the timer device.  The timer device is
-//	set up to interrupt the CPU periodically (once every TimerTicks).
+//	set up to interrupt the CPU periodically (once every time slice).
 //	This routine is called each time there is a timer interrupt,
 //	with interrupts disabled.
 //
+//	The scheduler decides whether the interrupted thread has had
+//	its share of the CPU for now; with -rs, we always switch, to
+//	shake out synchronization bugs.
+//
 //	Note that instead of calling Yield() directly (which would
 //	suspend the interrupt handler, not the interrupted thread
 //	which is what we wanted to context switch), we set a flag
@@ -64,8 +84,11 @@ extern void Cleanup();
 static void
 TimerInterruptHandler(int dummy)
 {
-    if (interrupt->getStatus() != IdleMode)
+    if (interrupt->getStatus() != IdleMode
+	  && (scheduler->ShouldYield() || randomYield)) {
+	stats->numPreemptions++;
 	interrupt->YieldOnReturn();
+    }
 }
 
 //----------------------------------------------------------------------
@@ -83,10 +106,19 @@ Initialize(int argc, char **argv)
 {
     int argCount;
     const char* debugArgs = "";
-    bool randomYield = FALSE;
+    int quantum = 0;		// time slice length, 0 if not time slicing
 
 #ifdef USER_PROGRAM
     bool debugUserProg = FALSE;	// single step user program
+    bool translateBlocks = FALSE; // run user code as translated blocks
+    int tlbEntries = TLBSize;	// size of the TLB, if there is one
+#endif
+#ifdef VM
+    ReplacementPolicy policy = FIFOReplacement; // how to pick pages to evict
+#endif
+#ifdef USE_TLB
+    TLBPolicy tlbPolicy = TLBFIFOReplacement; // how to pick TLB entries
+					// to replace
 #endif
 #ifdef FILESYS_NEEDED
     bool format = FALSE;	// format disk
@@ -111,10 +143,55 @@ Initialize(int argc, char **argv)
 						// number generator
 	    randomYield = TRUE;
 	    argCount = 2;
+	} else if (!strcmp(*argv, "-quantum")) {
+	    ASSERT(argc > 1);
+	    quantum = atoi(*(argv + 1));	// preempt threads every
+						// "quantum" ticks
+	    ASSERT(quantum > 0);
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-tpool")) {
+	    ASSERT(argc > 1);
+	    Thread::SetPoolLimit(atoi(*(argv + 1)));	// how many finished
+						// threads to keep for reuse
+	    argCount = 2;
 	}
 #ifdef USER_PROGRAM
 	if (!strcmp(*argv, "-s"))
 	    debugUserProg = TRUE;
+	else if (!strcmp(*argv, "-jit"))
+	    translateBlocks = TRUE;
+#endif
+#ifdef VM
+	if (!strcmp(*argv, "-rp")) {
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "fifo"))
+		policy = FIFOReplacement;
+	    else if (!strcmp(*(argv + 1), "clock"))
+		policy = ClockReplacement;
+	    else if (!strcmp(*(argv + 1), "lru"))
+		policy = LRUReplacement;
+	    else
+		ASSERT(FALSE);		// unknown replacement policy
+	    argCount = 2;
+	}
+#endif
+#ifdef USE_TLB
+	if (!strcmp(*argv, "-tlb")) {
+	    ASSERT(argc > 1);
+	    tlbEntries = atoi(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-tlbp")) {
+	    ASSERT(argc > 1);
+	    if (!strcmp(*(argv + 1), "fifo"))
+		tlbPolicy = TLBFIFOReplacement;
+	    else if (!strcmp(*(argv + 1), "random"))
+		tlbPolicy = TLBRandomReplacement;
+	    else if (!strcmp(*(argv + 1), "clock"))
+		tlbPolicy = TLBClockReplacement;
+	    else
+		ASSERT(FALSE);		// unknown replacement policy
+	    argCount = 2;
+	}
 #endif
 #ifdef FILESYS_NEEDED
 	if (!strcmp(*argv, "-f"))
@@ -137,8 +214,12 @@ Initialize(int argc, char **argv)
     stats = new Statistics();			// collect statistics
     interrupt = new Interrupt;			// start up interrupt handling
     scheduler = new Scheduler();		// initialize the ready queue
-    if (randomYield)				// start the timer (if needed)
-	timer = new Timer(TimerInterruptHandler, 0, randomYield);
+    alarmClock = new Alarm();			// and the wakeup queue
+    if (quantum > 0)
+	scheduler->SetQuantum(quantum);
+    if (randomYield || quantum > 0)		// start the timer (if needed)
+	timer = new Timer(TimerInterruptHandler, 0, randomYield,
+			  scheduler->GetQuantum());
 
     threadToBeDestroyed = NULL;
 
@@ -152,10 +233,16 @@ Initialize(int argc, char **argv)
     CallOnUserAbort(Cleanup);			// if user hits ctl-C
     
 #ifdef USER_PROGRAM
-    machine = new Machine(debugUserProg);	// this must come first
+    machine = new Machine(debugUserProg, translateBlocks, tlbEntries);
+					// this must come first
     mm = new MemoryManager();
     mmLock = new Lock("mmLock");
+    joinLock = new Lock("joinLock");
+    textCache = new TextCache();
     pcbManager = new PCBManager(MAX_PROCESSES);
+    synchConsole = NULL;		// the console device polls for
+					// input forever, so don't start
+					// it unless a program uses it
 #endif
 
 #ifdef FILESYS
@@ -166,6 +253,14 @@ Initialize(int argc, char **argv)
     fileSystem = new FileSystem(format);
 #endif
 
+#ifdef VM
+    pager = new Pager(policy);		// after the file system, which
+					// holds the swap file
+#endif
+#ifdef USE_TLB
+    tlbManager = new TLBManager(tlbPolicy);
+#endif
+
 #ifdef NETWORK
     postOffice = new PostOffice(netname, rely, 10);
 #endif
@@ -183,6 +278,14 @@ Cleanup()
     delete postOffice;
 #endif
     
+#ifdef USE_TLB
+    delete tlbManager;
+#endif
+
+#ifdef VM
+    delete pager;
+#endif
+
 #ifdef USER_PROGRAM
     delete machine;
 #endif
@@ -196,6 +299,7 @@ Cleanup()
 #endif
     
     delete timer;
+    delete alarmClock;
     delete scheduler;
     delete interrupt;
     
@@ -15,6 +15,7 @@
 #include "interrupt.h"
 #include "stats.h"
 #include "timer.h"
+#include "alarm.h"
 
 // Initialization and cleanup routines
 extern void Initialize(int argc, char **argv); 	// Initialization,
@@ -28,16 +29,23 @@ extern Scheduler *scheduler;			// the ready list
 extern Interrupt *interrupt;			// interrupt status
 extern Statistics *stats;			// performance metrics
 extern Timer *timer;				// the hardware alarm clock
+extern Alarm *alarmClock;			// wakes up sleeping threads
 
 #ifdef USER_PROGRAM
 #include "machine.h"
 #include "memorymanager.h"
 #include "synch.h"
 #include "pcbmanager.h"
+#include "synchconsole.h"
+#include "textcache.h"
 extern Machine* machine;	// user program memory and registers
 extern MemoryManager* mm;
 extern Lock *mmLock;
+extern Lock *joinLock;		// for Join and Exit (see pcb.h)
+extern TextCache *textCache;	// code pages shared between processes
 extern PCBManager *pcbManager;
+extern SynchConsole *synchConsole; // console for user programs, created
+				// on first use
 #endif
 
 #ifdef FILESYS_NEEDED 		// FILESYS or FILESYS_STUB 
@@ -45,6 +53,16 @@ extern PCBManager *pcbManager;
 extern FileSystem  *fileSystem;
 #endif
 
+#ifdef VM
+#include "pager.h"
+extern Pager *pager;		// brings pages in on demand
+#endif
+
+#ifdef USE_TLB
+#include "tlbmanager.h"
+extern TLBManager *tlbManager;	// refills the TLB on a miss
+#endif
+
 #ifdef FILESYS
 #include "synchdisk.h"
 extern SynchDisk   *synchDisk;
@@ -24,6 +24,96 @@
 					// execution stack, for detecting 
 					// stack overflows
 
+// Free thread control blocks and stacks, waiting to be reused.  Each is
+// linked to the next through its first word.
+static void *freeTCBs = NULL;
+static int numFreeTCBs = 0;
+static void *freeStacks = NULL;
+static int numFreeStacks = 0;
+static int poolLimit = DefaultThreadPoolLimit;
+
+int Thread::numStacksAllocated = 0;
+
+//----------------------------------------------------------------------
+// Thread::operator new, Thread::operator delete
+// 	Allocate a thread control block, reusing a free one if we have
+//	one; and free one, keeping it for reuse if the pool isn't full.
+//----------------------------------------------------------------------
+
+void *
+Thread::operator new(size_t size)
+{
+    void *tcb = freeTCBs;
+
+    ASSERT(size == sizeof(Thread));
+    if (tcb == NULL)
+	return ::operator new(size);
+    freeTCBs = *(void **) tcb;
+    numFreeTCBs--;
+    return tcb;
+}
+
+void
+Thread::operator delete(void *tcb)
+{
+    if (numFreeTCBs >= poolLimit) {
+	::operator delete(tcb);
+	return;
+    }
+    *(void **) tcb = freeTCBs;
+    freeTCBs = tcb;
+    numFreeTCBs++;
+}
+
+//----------------------------------------------------------------------
+// AllocStack, FreeStack
+// 	Get an execution stack, reusing a free one if we have one, and
+//	give one back, keeping it for reuse if the pool isn't full.
+//	Only stacks we can't keep are returned to the host, along with
+//	their guard pages.
+//----------------------------------------------------------------------
+
+static int *
+AllocStack()
+{
+    int *stack = (int *) freeStacks;
+
+    if (stack == NULL) {
+	Thread::numStacksAllocated++;
+	return (int *) AllocBoundedArray(StackSize * sizeof(int));
+    }
+    freeStacks = *(void **) stack;
+    numFreeStacks--;
+    return stack;
+}
+
+static void
+FreeStack(int *stack)
+{
+    if (numFreeStacks >= poolLimit) {
+	DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
+	return;
+    }
+    *(void **) stack = freeStacks;
+    freeStacks = stack;
+    numFreeStacks++;
+}
+
+//----------------------------------------------------------------------
+// Thread::SetPoolLimit
+// 	Set the high-water mark for the free TCB and stack pools; anything
+//	beyond it is given back when a thread is destroyed.
+//
+//	"limit" is how many of each to keep; 0 turns pooling off.
+//----------------------------------------------------------------------
+
+void
+Thread::SetPoolLimit(int limit)
+{
+    ASSERT(limit >= 0);
+    poolLimit = limit;
+}
+
 //----------------------------------------------------------------------
 // Thread::Thread
 // 	Initialize a thread control block, so that we can then call
@@ -38,8 +128,16 @@ Thread::Thread(const char* threadName)
     stackTop = NULL;
     stack = NULL;
     status = JUST_CREATED;
+    priority = 0;
+    ticksUsed = 0;
+    inheritedPriority = NumPriorityLevels;
+    waitingOn = NULL;
+    queueLink.item = this;
+    sleepLink.item = this;
+    timedOut = FALSE;
 #ifdef USER_PROGRAM
     space = NULL;
+    pcb = NULL;
 #endif
 }
 
@@ -61,7 +159,10 @@ Thread::~Thread()
 
     ASSERT(this != currentThread);
     if (stack != NULL)
-	DeallocBoundedArray((char *) stack, StackSize * sizeof(int));
+	FreeStack(stack);
+#ifdef USER_PROGRAM
+    scheduler->ForgetThread(this);
+#endif
 }
 
 //----------------------------------------------------------------------
@@ -225,6 +326,22 @@ Thread::Sleep ()
     scheduler->Run(nextThread); // returns when we've been signalled
 }
 
+//----------------------------------------------------------------------
+// Thread::SleepUntil
+// 	Relinquish the CPU until simulated time reaches "when", rather
+//	than spinning on Yield.  Returns immediately if that time has
+//	already passed.
+//
+//	"when" is the time to wake up, in ticks (cf. stats->totalTicks).
+//----------------------------------------------------------------------
+
+void
+Thread::SleepUntil (int when)
+{
+    ASSERT(this == currentThread);
+    alarmClock->WaitUntil(when);
+}
+
 //----------------------------------------------------------------------
 // ThreadFinish, InterruptEnable, ThreadPrint
 //	Dummy functions because C++ does not allow a pointer to a member
@@ -252,7 +369,7 @@ void ThreadPrint(int arg){ Thread *t = (Thread *)arg; t->Print(); }
 void
 Thread::StackAllocate (VoidFunctionPtr func, int arg)
 {
-    stack = (int *) AllocBoundedArray(StackSize * sizeof(int));
+    stack = AllocStack();
 
 #ifdef HOST_SNAKE
     // HP stack works from low addresses to high addresses
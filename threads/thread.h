@@ -30,6 +30,11 @@
 //	We must first allocate a data structure for it: "t = new Thread".
 //	Only then can we do the fork: "t->fork(f, arg)".
 //
+//	Thread control blocks and stacks of threads that have finished
+//	are kept on free lists (up to a limit), and handed out again by
+//	"new Thread" and Fork, so that creating a thread doesn't have to
+//	go to the host for memory each time.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -39,12 +44,16 @@
 
 #include "copyright.h"
 #include "utility.h"
+#include "list.h"
+
+class Lock;
 
 #ifdef USER_PROGRAM
 #include "machine.h"
 #include "addrspace.h"
 
 class AddrSpace;
+class PCB;
 #endif
 
 // CPU register state to be saved on context switch.  
@@ -57,6 +66,13 @@ class AddrSpace;
 // WATCH OUT IF THIS ISN'T BIG ENOUGH!!!!!
 #define StackSize	(4 * 1024)	// in words
 
+// Number of scheduler priority levels; level 0 is the highest priority.
+#define NumPriorityLevels 4
+
+// Default for how many free thread control blocks and stacks to keep
+// for reuse (see Thread::SetPoolLimit).
+#define DefaultThreadPoolLimit 16
+
 
 // Thread state
 enum ThreadStatus { JUST_CREATED, RUNNING, READY, BLOCKED };
@@ -91,19 +107,46 @@ class Thread {
 
     // basic thread operations
 
+    static void *operator new(size_t size);	// Allocate a TCB, from the
+						// pool if there is one free
+    static void operator delete(void *tcb);	// Return a TCB to the pool
+    static void SetPoolLimit(int limit);	// Keep at most "limit" free
+						// TCBs and stacks around
+    static int numStacksAllocated;		// stacks the host gave us
+
     void Fork(VoidFunctionPtr func, int arg); 	// Make thread run (*func)(arg)
     void Yield();  				// Relinquish the CPU if any 
 						// other thread is runnable
     void Sleep();  				// Put the thread to sleep and 
 						// relinquish the processor
     void Finish();  				// The thread is done executing
+    void SleepUntil(int when);			// Put the thread to sleep
+						// until simulated time "when"
     
     void CheckOverflow();   			// Check if thread has 
 						// overflowed its stack
     void setStatus(ThreadStatus st) { status = st; }
+    ThreadStatus getStatus() { return (status); }
     const char* getName() { return (name); }
     void Print() { printf("%s, ", name); }
 
+    int priority;			// scheduler level, 0 is highest
+    int ticksUsed;			// CPU time used at this level
+    int inheritedPriority;		// best level donated by threads
+					// waiting for locks we hold, or
+					// NumPriorityLevels if none
+    int EffectivePriority()		// the level we are scheduled at
+	{ return (inheritedPriority < priority) ? inheritedPriority 
+						: priority; }
+    Lock *waitingOn;			// the lock we are blocked on, if any
+    IntrusiveList heldLocks;		// the locks we hold
+
+    ListLink queueLink;			// on a ready list, or the wait
+					// queue we're blocked on
+    ListLink sleepLink;			// on the alarm's wakeup queue
+    bool timedOut;			// TRUE if our last timed wait
+					// ran out of time
+
   private:
     // some of the private data for this class is listed above
     
@@ -129,6 +172,10 @@ class Thread {
     void RestoreUserState();		// restore user-level register state
 
     AddrSpace *space;			// User code this thread is running.
+					// (Shared by the threads of a
+					// process.)
+    PCB *pcb;				// This thread's process control
+					// block
 #endif
 };
 
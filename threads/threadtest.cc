@@ -129,3 +129,113 @@ ThreadTest()
 
 #endif 
 
+//----------------------------------------------------------------------
+// SynchBenchmark
+// 	Measure the cost of the context switch and synchronization paths.
+//	Two threads play ping-pong through a pair of semaphores, and then
+//	take turns on a lock, "rounds" times each; every round blocks and
+//	wakes a thread.  We report how many context switches that took,
+//	and how many list elements were allocated along the way -- with
+//	the wait queues and ready lists linked through the threads
+//	themselves, that should be none.
+//----------------------------------------------------------------------
+
+static Semaphore *ping, *pong;
+static Lock *benchLock;
+static Semaphore *benchDone;
+
+static void
+BenchPartner(int rounds)
+{
+    for (int i = 0; i < rounds; i++) {
+	ping->P();
+	pong->V();
+    }
+    for (int i = 0; i < rounds; i++) {
+	benchLock->Acquire();
+	currentThread->Yield();
+	benchLock->Release();
+    }
+    benchDone->V();
+}
+
+void
+SynchBenchmark(int rounds)
+{
+    ping = new Semaphore("ping", 0);
+    pong = new Semaphore("pong", 0);
+    benchLock = new Lock("benchLock");
+    benchDone = new Semaphore("benchDone", 0);
+
+    int elements = ListElement::numAllocated;
+    int switches = stats->numContextSwitches;
+    int handoffs = stats->numLockHandoffs;
+    int ticks = stats->totalTicks;
+
+    Thread *t = new Thread("bench partner");
+    t->Fork(BenchPartner, rounds);
+    for (int i = 0; i < rounds; i++) {
+	ping->V();
+	pong->P();
+    }
+    for (int i = 0; i < rounds; i++) {
+	benchLock->Acquire();
+	currentThread->Yield();
+	benchLock->Release();
+    }
+    benchDone->P();
+
+    printf("Synch benchmark: %d rounds, %d context switches, %d ticks, "
+	   "%d lock handoffs, %d list elements allocated\n", rounds,
+	   stats->numContextSwitches - switches, stats->totalTicks - ticks,
+	   stats->numLockHandoffs - handoffs,
+	   ListElement::numAllocated - elements);
+
+    delete ping;
+    delete pong;
+    delete benchLock;
+    delete benchDone;
+}
+
+//----------------------------------------------------------------------
+// ForkBenchmark
+// 	Measure the cost of creating threads.  Fork "numThreads" short-lived
+//	threads, a few at a time, waiting for each batch to finish before
+//	forking the next, and report how many stacks had to be allocated
+//	from the host.  With finished threads' stacks and control blocks
+//	recycled, that should be about one batch's worth (cf. -tpool).
+//----------------------------------------------------------------------
+
+#define ForkBatch 8
+
+static Semaphore *forkDone;
+
+static void
+ForkedThread(int which)
+{
+    forkDone->V();
+}
+
+void
+ForkBenchmark(int numThreads)
+{
+    forkDone = new Semaphore("forkDone", 0);
+
+    int stacks = Thread::numStacksAllocated;
+    int ticks = stats->totalTicks;
+
+    for (int i = 0; i < numThreads; i += ForkBatch) {
+	for (int j = 0; j < ForkBatch; j++) {
+	    Thread *t = new Thread("forked thread");
+	    t->Fork(ForkedThread, i + j);
+	}
+	for (int j = 0; j < ForkBatch; j++)
+	    forkDone->P();
+    }
+
+    printf("Fork benchmark: %d threads, %d ticks, %d stacks allocated\n",
+	   numThreads, stats->totalTicks - ticks,
+	   Thread::numStacksAllocated - stacks);
+
+    delete forkDone;
+}
@@ -18,7 +18,6 @@
 #include "copyright.h"
 #include "system.h"
 #include "addrspace.h"
-#include "noff.h"
 #ifdef HOST_SPARC
 #include <strings.h>
 #endif
@@ -45,6 +44,29 @@ SwapHeader (NoffHeader *noffH)
 	noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
 }
 
+#ifndef VM
+//----------------------------------------------------------------------
+// Overlaps, IsZeroFill
+// 	Return TRUE if the virtual page starting at "pageAddr" overlaps
+//	the segment "seg", or if it holds neither code nor initialized
+//	data, and so starts out all zeros.
+//----------------------------------------------------------------------
+
+static bool
+Overlaps(Segment *seg, int pageAddr)
+{
+    return (seg->size > 0) && (pageAddr < seg->virtualAddr + seg->size)
+			&& (seg->virtualAddr < pageAddr + PageSize);
+}
+
+static bool
+IsZeroFill(NoffHeader *noffH, int pageAddr)
+{
+    return !Overlaps(&noffH->code, pageAddr)
+			&& !Overlaps(&noffH->initData, pageAddr);
+}
+#endif
+
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
 // 	Create an address space to run a user program.
@@ -57,15 +79,35 @@ SwapHeader (NoffHeader *noffH)
 //	memory.  For now, this is really simple (1:1), since we are
 //	only uniprogramming, and we have a single unsegmented page table
 //
-//	"executable" is the file containing the object code to load into memory
+//	Pages that hold nothing but code are shared with any other address
+//	space running the same program (see textcache.h), and mapped
+//	read-only and copy-on-write; only the pages not already in the
+//	cache are read in.  Likewise every page of bss and stack is mapped
+//	to the one frame of zeros (see MemoryManager::GetZeroPage), and
+//	gets a frame of its own only when it is first written.
+//
+//	With demand paging (VM), nothing is loaded here: every page starts
+//	out invalid, and is filled in by LoadPage when it is first touched.
+//	The address space keeps its own handle on the executable for that,
+//	and a swap slot per page for pages that have been evicted dirty.
+//
+//	"executableFile" is the file containing the object code to load
+//		into memory
+//	"executableName" is the name of that file
 //----------------------------------------------------------------------
 
-AddrSpace::AddrSpace(OpenFile *executable)
+AddrSpace::AddrSpace(OpenFile *executableFile, char *executableName)
 {
+#ifndef VM
     NoffHeader noffH;
+    int *sharedFrame;			// frame shared with other address
+					// spaces, for each page, or -1
+    unsigned int numShared = 0;		// how many of those there are
+    int zeroPage;
+#endif
     unsigned int i, size;
 
-    executable->ReadAt((char *)&noffH, sizeof(noffH), 0);
+    executableFile->ReadAt((char *)&noffH, sizeof(noffH), 0);
     if ((noffH.noffMagic != NOFFMAGIC) &&
 		(WordToHost(noffH.noffMagic) == NOFFMAGIC))
     	SwapHeader(&noffH);
@@ -83,61 +125,150 @@ AddrSpace::AddrSpace(OpenFile *executable)
     numPages = divRoundUp(size, PageSize);
     size = numPages * PageSize;
 
-    if(numPages > mm->GetFreePageCount()) {
+#ifndef VM
+    // Share whatever code pages are cached, and the zero frame, taking
+    // our references to them now so that making room for the rest
+    // can't free them
+    mmLock->Acquire();
+    zeroPage = mm->GetZeroPage();
+    sharedFrame = new int[numPages];
+    for (i = 0; i < numPages; i++) {
+        sharedFrame[i] = -1;
+        if (TextCache::IsTextPage(&noffH, i))
+            sharedFrame[i] = textCache->Lookup(executableName, &noffH, i);
+        else if (IsZeroFill(&noffH, i * PageSize))
+            sharedFrame[i] = zeroPage;
+        if (sharedFrame[i] != -1) {
+            mm->SharePage(sharedFrame[i]);
+            numShared++;
+        }
+    }
+    while ((numPages - numShared > mm->GetFreePageCount())
+                && textCache->ReclaimIdle())
+        ;
+    if(numPages - numShared > mm->GetFreePageCount()) {
+        for (i = 0; i < numPages; i++)
+            if (sharedFrame[i] != -1)
+                mm->DeallocatePage(sharedFrame[i]);
+        mmLock->Release();
+        delete [] sharedFrame;
+        valid = false;
+        return;
+    }
+#else
+    // Pages are read in from a file of our own, opened before any of
+    // them are set up, since the caller closes "executableFile"
+    executable = fileSystem->Open(executableName);
+    if (executable == NULL) {
         valid = false;
         return;
     }
+    fileName = new char[strlen(executableName) + 1];
+    strcpy(fileName, executableName);
+#endif
     
     printf("Loaded Program: [%d] code | [%d] data | [%d] bss\n", noffH.code.size, noffH.initData.size, noffH.uninitData.size);
 
-    // Allocate a new PCB for the address space
-    pcb = pcbManager->AllocatePCB();
-    pcb->thread = currentThread;
+    // The thread creating the address space runs on the stack at the
+    // end of the program; more can be added (see AllocateStack)
+    refCount = 1;
+    basePages = numPages;
+    stackSlots = new BitMap(MaxStacks);
+    stackSlots->Mark(0);
 
     DEBUG('a', "Initializing address space, num pages %d, size %d\n",
 					numPages, size);
 // first, set up the translation
     pageTable = new TranslationEntry[numPages];
+    copyOnWrite = new bool[numPages];
+#ifdef VM
+    swapSlot = new int[numPages];
+#endif
     for (i = 0; i < numPages; i++) {
+        copyOnWrite[i] = FALSE;
+#ifdef VM
+        swapSlot[i] = -1;
+#endif
         pageTable[i].virtualPage = i;	// for now, virtual page # = phys page #
-        pageTable[i].physicalPage = mm->AllocatePage();
+#ifdef VM
+        pageTable[i].physicalPage = 0;  // not in memory until first touched
+        pageTable[i].valid = FALSE;
+#else
+        if (sharedFrame[i] != -1)
+            pageTable[i].physicalPage = sharedFrame[i];
+        else
+            pageTable[i].physicalPage = mm->AllocatePage();
         pageTable[i].valid = TRUE;
+#endif
         pageTable[i].use = FALSE;
         pageTable[i].dirty = FALSE;
         pageTable[i].readOnly = FALSE;  // if the code segment was entirely on
                         // a separate page, we could set its
                         // pages to be read-only
 
+#ifndef VM
         // Zero out each page, to zero the unitialized data segment
         // and the stack segment
         unsigned int physicalPageAddress = (pageTable[i].physicalPage)*128;
-        bzero(&(machine->mainMemory[physicalPageAddress]), 128);
+        if (sharedFrame[i] == -1)
+            bzero(&(machine->mainMemory[physicalPageAddress]), 128);
+#endif
     }
 
-     // then, copy in the code and data segments into memory
+#ifndef VM
+
+     // then, copy in the code and data segments into memory, reading
+     // each physically contiguous run of pages straight from the file.
+     // The shared code pages are read-only, so runs stop short of them.
     if (noffH.code.size > 0) {
         DEBUG('a', "Initializing code segment, at 0x%x, size %d\n",
 			noffH.code.virtualAddr, noffH.code.size);
-        int counter = 0;
+        int counter = 0, physAddr, run, vpn;
         while( counter < noffH.code.size) {
-
-            executable->ReadAt(&(machine->mainMemory[Translate(noffH.code.virtualAddr+counter)]),
-                1, noffH.code.inFileAddr+counter);
-            counter++;
+            vpn = (noffH.code.virtualAddr+counter) / PageSize;
+            if (sharedFrame[vpn] != -1) {         // already there
+                counter = (vpn + 1) * PageSize - noffH.code.virtualAddr;
+                continue;
+            }
+            run = TranslateRun(noffH.code.virtualAddr+counter,
+                        noffH.code.size-counter, TRUE, &physAddr);
+            ASSERT(run > 0);
+            executableFile->ReadAt(&(machine->mainMemory[physAddr]),
+                run, noffH.code.inFileAddr+counter);
+            counter += run;
         }
     }
     if (noffH.initData.size > 0) {
         DEBUG('a', "Initializing data segment, at 0x%x, size %d\n",
 			noffH.initData.virtualAddr, noffH.initData.size);
-        int counter = 0;
+        int counter = 0, physAddr, run;
         while( counter < noffH.initData.size) {
-        	executable->ReadAt(&(machine->mainMemory[Translate(noffH.initData.virtualAddr+counter)]),
-				1, noffH.initData.inFileAddr+counter);
-            counter++;
+            run = TranslateRun(noffH.initData.virtualAddr+counter,
+                        noffH.initData.size-counter, FALSE, &physAddr);
+            ASSERT(run > 0);
+        	executableFile->ReadAt(&(machine->mainMemory[physAddr]),
+				run, noffH.initData.inFileAddr+counter);
+            counter += run;
         }
 
     }
 
+    // Code pages are read-only from here on, and those just read in
+    // are offered to the next process to run this program.  Zero-fill
+    // pages are copied (as zeros) when they are first written.
+    for (i = 0; i < numPages; i++) {
+        if (TextCache::IsTextPage(&noffH, i)) {
+            if (sharedFrame[i] == -1)
+                textCache->Insert(executableName, &noffH, i, pageTable[i].physicalPage);
+        } else if (sharedFrame[i] == -1)       // not a zero-fill page
+            continue;
+        pageTable[i].readOnly = TRUE;
+        copyOnWrite[i] = TRUE;
+    }
+    mmLock->Release();
+    delete [] sharedFrame;
+#endif
+
     valid = true;
 
 
@@ -153,52 +284,6 @@ unsigned int AddrSpace::GetNumPages() {
 }
 
 
-//----------------------------------------------------------------------
-// AddrSpace::AddrSpace
-// 	Create an address space as a copy of an existing one
-//----------------------------------------------------------------------
-
-AddrSpace::AddrSpace(AddrSpace* space) {
-
-    valid = true;
-
-    // 1. Find how big the source address space is
-    unsigned int n = space->GetNumPages();
-
-    // Acquire mmLock
-    mmLock->Acquire();
-
-    // 2. Check if there is enough free memory to make the copy. IF not, fail
-    ASSERT(n <= mm->GetFreePageCount());
-    // Change this to informiing caller that constructor failed using valid=false;
-
-    // 3. Create a new pagetable of same size as source addr space
-    pageTable = new TranslationEntry[n];
-    numPages = n;
-
-    // 4. Make a copy of the PTEs but allocate new physical pages
-    TranslationEntry* ppt = space->GetPageTable();
-    for (unsigned int i = 0; i < numPages; i++) {
-        pageTable[i].virtualPage = ppt[i].virtualPage;
-        pageTable[i].physicalPage = mm->AllocatePage();
-        pageTable[i].valid = ppt[i].valid;
-        pageTable[i].use = ppt[i].use;
-        pageTable[i].dirty = ppt[i].dirty;
-        pageTable[i].readOnly = ppt[i].readOnly;
-
-        // 5. For each page, make an actual copy of the contents of the page
-        bcopy(  &(machine->mainMemory[ppt[i].physicalPage*128]),
-                &(machine->mainMemory[pageTable[i].physicalPage*128]),
-                128);
-    }
-
-    // Release mmLock
-    mmLock->Release();
-
-}
-
-
-
 //----------------------------------------------------------------------
 // AddrSpace::~AddrSpace
 // 	Dealloate an address space.  Nothing for now!
@@ -206,10 +291,35 @@ AddrSpace::AddrSpace(AddrSpace* space) {
 
 AddrSpace::~AddrSpace()
 {
+#ifdef VM
+    mmLock->Acquire();		// keep the pager from evicting our pages
+#endif
+#ifdef USE_TLB
+    tlbManager->Flush();	// the TLB may be holding our entries
+#endif
     for(int i = 0; i<numPages; i++){
-        mm->DeallocatePage(pageTable[i].physicalPage);
+#ifdef VM
+        if (pageTable[i].valid)
+            pager->ReleaseFrame(pageTable[i].physicalPage, this);
+        if (swapSlot[i] != -1)
+            pager->swap->Free(swapSlot[i]);
+#endif
+        if (pageTable[i].valid)
+            mm->DeallocatePage(pageTable[i].physicalPage);
     }
+#ifdef VM
+    mmLock->Release();
+#endif
     delete pageTable;
+    delete [] copyOnWrite;
+    delete stackSlots;
+#ifdef VM
+    delete [] swapSlot;
+    delete executable;
+    delete [] fileName;
+#endif
+    machine->FlushTranslationCache();	// our frames are about to be reused
+    scheduler->ForgetSpace(this);
 }
 
 //----------------------------------------------------------------------
@@ -240,8 +350,231 @@ AddrSpace::InitRegisters()
    // Set the stack register to the end of the address space, where we
    // allocated the stack; but subtract off a bit, to make sure we don't
    // accidentally reference off the end!
-    machine->WriteRegister(StackReg, numPages * PageSize - 16);
-    DEBUG('a', "Initializing stack register to %d\n", numPages * PageSize - 16);
+    machine->WriteRegister(StackReg, StackTop(0) - 16);
+    DEBUG('a', "Initializing stack register to %d\n", StackTop(0) - 16);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AddReference, AddrSpace::RemoveReference
+// 	Count the threads running in this address space.  The last one
+//	to leave deletes it.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::AddReference()
+{
+    return ++refCount;
+}
+
+int
+AddrSpace::RemoveReference()
+{
+    ASSERT(refCount > 0);
+    return --refCount;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::StackTop
+// 	Return the virtual address just past the top of the user stack
+//	in "slot".  Slot 0 is the stack at the end of the program, where
+//	the first thread runs; the others come after it, StackPages
+//	apiece, in the order they were first needed.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::StackTop(int slot)
+{
+    if (slot == 0)
+	return basePages * PageSize;
+    return (basePages + slot * StackPages) * PageSize;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AllocateStack
+// 	Find a stack for a new thread in this address space, growing the
+//	page table if every stack so far is in use.  The stack's pages
+//	start out as zeros, and cost nothing until they are touched: they
+//	are mapped to the zero frame (or, with demand paging, not mapped
+//	at all).
+//
+// Returns:
+//	The stack's slot, or -1 if there are too many threads or no
+//	memory for the stack.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::AllocateStack()
+{
+    unsigned int first, vpn;
+    int slot;
+
+    mmLock->Acquire();
+    if ((slot = stackSlots->Find()) == -1) {
+	mmLock->Release();
+	return -1;
+    }
+    first = StackTop(slot) / PageSize - StackPages;
+    if (first + StackPages > numPages)
+	GrowPageTable(first + StackPages);
+    for (vpn = first; vpn < first + StackPages; vpn++)
+	if (!MapZeroPage(vpn)) {
+	    while (vpn-- > first)
+		UnmapPage(vpn);
+	    stackSlots->Clear(slot);
+	    mmLock->Release();
+	    return -1;
+	}
+    mmLock->Release();
+
+    machine->FlushTranslationCache();	// the page table just changed
+    return slot;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::FreeStack
+// 	Give up the stack in "slot", once its thread has exited.  The
+//	page table keeps its size; the slot is reused by the next thread.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::FreeStack(int slot)
+{
+    unsigned int first = StackTop(slot) / PageSize - StackPages;
+
+    ASSERT((slot > 0) && stackSlots->Test(slot));
+    mmLock->Acquire();
+    for (unsigned int vpn = first; vpn < first + StackPages; vpn++)
+	UnmapPage(vpn);
+    stackSlots->Clear(slot);
+    mmLock->Release();
+
+    machine->FlushTranslationCache();	// the page table just changed
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::GrowPageTable
+// 	Make the page table "n" pages long.  The new pages are invalid.
+//	If the machine is using the old page table, switch it over.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::GrowPageTable(unsigned int n)
+{
+    TranslationEntry *oldTable = pageTable;
+    bool *oldCopyOnWrite = copyOnWrite;
+#ifdef VM
+    int *oldSwapSlot = swapSlot;
+#endif
+    unsigned int i;
+
+    ASSERT(n > numPages);
+    pageTable = new TranslationEntry[n];
+    copyOnWrite = new bool[n];
+#ifdef VM
+    swapSlot = new int[n];
+#endif
+    for (i = 0; i < n; i++) {
+	if (i < numPages) {
+	    pageTable[i] = oldTable[i];
+	    copyOnWrite[i] = oldCopyOnWrite[i];
+#ifdef VM
+	    swapSlot[i] = oldSwapSlot[i];
+#endif
+	    continue;
+	}
+	pageTable[i].virtualPage = i;
+	pageTable[i].physicalPage = 0;
+	pageTable[i].valid = FALSE;
+	pageTable[i].use = FALSE;
+	pageTable[i].dirty = FALSE;
+	pageTable[i].readOnly = FALSE;
+	copyOnWrite[i] = FALSE;
+#ifdef VM
+	swapSlot[i] = -1;
+#endif
+    }
+    if (machine->pageTable == oldTable) {
+	machine->pageTable = pageTable;
+	machine->pageTableSize = n;
+    }
+    numPages = n;
+    delete [] oldTable;
+    delete [] oldCopyOnWrite;
+#ifdef VM
+    delete [] oldSwapSlot;
+#endif
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::MapZeroPage
+// 	Set up virtual page "vpn" as a page of zeros, that gets a frame
+//	of its own when it is first written.  Called with mmLock held.
+//
+// Returns:
+//	FALSE if there is no zero frame, and no free frame either.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::MapZeroPage(unsigned int vpn)
+{
+    TranslationEntry *entry = &pageTable[vpn];
+
+    entry->virtualPage = vpn;
+    entry->use = FALSE;
+    entry->dirty = FALSE;
+#ifdef VM
+    entry->physicalPage = 0;		// LoadPage zeroes it on first touch
+    entry->valid = FALSE;
+    entry->readOnly = FALSE;
+    copyOnWrite[vpn] = FALSE;
+#else
+    int frame = mm->GetZeroPage();
+
+    if (frame != -1) {
+	mm->SharePage(frame);
+	entry->readOnly = TRUE;
+	copyOnWrite[vpn] = TRUE;
+    } else {
+	if (((frame = mm->AllocatePage()) == -1) && textCache->ReclaimIdle())
+	    frame = mm->AllocatePage();
+	if (frame == -1)
+	    return FALSE;
+	bzero(&(machine->mainMemory[frame * PageSize]), PageSize);
+	entry->readOnly = FALSE;
+	copyOnWrite[vpn] = FALSE;
+    }
+    entry->physicalPage = frame;
+    entry->valid = TRUE;
+#endif
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::UnmapPage
+// 	Drop virtual page "vpn", and whatever frame or swap slot holds it.
+//	Called with mmLock held.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::UnmapPage(unsigned int vpn)
+{
+#ifdef USE_TLB
+    tlbManager->Invalidate(this, vpn);
+#endif
+    if (pageTable[vpn].valid) {
+#ifdef VM
+	pager->ReleaseFrame(pageTable[vpn].physicalPage, this);
+#endif
+	mm->DeallocatePage(pageTable[vpn].physicalPage);
+	pageTable[vpn].valid = FALSE;
+    }
+#ifdef VM
+    if (swapSlot[vpn] != -1) {
+	pager->swap->Free(swapSlot[vpn]);
+	swapSlot[vpn] = -1;
+    }
+#endif
+    copyOnWrite[vpn] = FALSE;
 }
 
 //----------------------------------------------------------------------
@@ -249,24 +582,39 @@ AddrSpace::InitRegisters()
 // 	On a context switch, save any machine state, specific
 //	to this address space, that needs saving.
 //
-//	For now, nothing!
+//	With a TLB, that's the use and dirty bits in the TLB entries;
+//	the entries themselves are thrown away, since the TLB is shared
+//	by every address space.
 //----------------------------------------------------------------------
 
 void AddrSpace::SaveState()
-{}
+{
+#ifdef USE_TLB
+    tlbManager->Flush();
+#endif
+}
 
 //----------------------------------------------------------------------
 // AddrSpace::RestoreState
 // 	On a context switch, restore the machine state so that
 //	this address space can run.
 //
-//      For now, tell the machine where to find the page table.
+//      For now, tell the machine where to find the page table, and
+//	make it forget the translations it cached for the old one.
+//	With a TLB, the machine never sees the page table: the TLB
+//	starts out empty, and is refilled from the page table on each
+//	miss (see TLBManager::Refill).
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState()
 {
+#ifdef USE_TLB
+    tlbManager->Flush();
+#else
     machine->pageTable = pageTable;
     machine->pageTableSize = numPages;
+    machine->FlushTranslationCache();
+#endif
 }
 
 
@@ -280,3 +628,382 @@ unsigned int AddrSpace::Translate(unsigned int virtualAddr) {
 }
 
 
+
+//----------------------------------------------------------------------
+// AddrSpace::Accessible
+// 	Return TRUE if the kernel may read (or write, if "writing") the
+//	virtual page "vpn" of this address space, as it is right now.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::Accessible(unsigned int vpn, bool writing)
+{
+    return (vpn < numPages) && pageTable[vpn].valid
+			&& !(writing && pageTable[vpn].readOnly);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::MakeAccessible
+// 	Like Accessible, but first do whatever the user program's own
+//	access would have caused: page the page in (VM), and give a
+//	copy-on-write page its own frame before the kernel writes it.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::MakeAccessible(unsigned int vpn, bool writing)
+{
+    if (vpn >= numPages)
+	return FALSE;
+#ifdef VM
+    if (!pageTable[vpn].valid && !pager->PageIn(this, vpn))
+	return FALSE;
+#endif
+    if (writing && copyOnWrite[vpn]
+		&& !BreakCopyOnWrite(pageTable[vpn].virtualPage * PageSize))
+	return FALSE;
+    return Accessible(vpn, writing);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::TranslateRun
+// 	Translate the start of a range of user virtual addresses, for the
+//	kernel to read or write directly in mainMemory.  Consecutive
+//	virtual pages that sit in consecutive frames are merged into one
+//	run, so the caller can move the whole run with a single copy.
+//
+//	The first page is paged in, or copied, if need be; later pages are
+//	only merged into the run if they are usable as they stand, so that
+//	scanning a long range never pulls in more than it looks at.
+//
+//	Sets the use bit (and, if "writing", the dirty bit) of each page
+//	in the run, as the hardware would.  If "writing", the simulator
+//	is also told to forget any code it decoded from the run's frames,
+//	since the caller is about to overwrite them.
+//
+// Returns:
+//	The number of bytes at "virtAddr" that are contiguous in physical
+//	memory starting at "*physAddr" (at least 1, at most "size"), or
+//	-1 if the first page can't be accessed.
+//
+//	"virtAddr" -- the start of the range
+//	"size" -- the number of bytes wanted
+//	"writing" -- TRUE if the kernel is going to write the range
+//	"physAddr" -- the place to store the physical address of the run
+//----------------------------------------------------------------------
+
+int
+AddrSpace::TranslateRun(int virtAddr, int size, bool writing, int *physAddr)
+{
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    unsigned int offset = (unsigned) virtAddr % PageSize;
+    int run = PageSize - offset;
+
+    if ((virtAddr < 0) || !MakeAccessible(vpn, writing))
+	return -1;
+    *physAddr = pageTable[vpn].physicalPage * PageSize + offset;
+    for (;;) {
+	pageTable[vpn].use = TRUE;
+	if (writing) {
+	    pageTable[vpn].dirty = TRUE;
+	    machine->InvalidateCode(pageTable[vpn].physicalPage);
+	}
+	if (run >= size)
+	    return size;
+	if (!Accessible(vpn + 1, writing) || (pageTable[vpn + 1].physicalPage
+				!= pageTable[vpn].physicalPage + 1))
+	    return run;
+	vpn++;
+	run += PageSize;
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyFromUser
+// 	Copy "size" bytes of user memory at "virtAddr" into the kernel
+//	buffer "buf".  Returns FALSE if any of it isn't mapped.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CopyFromUser(int virtAddr, char *buf, int size)
+{
+    int physAddr, run;
+
+    while (size > 0) {
+	if ((run = TranslateRun(virtAddr, size, FALSE, &physAddr)) < 0)
+	    return FALSE;
+	bcopy(&(machine->mainMemory[physAddr]), buf, run);
+	virtAddr += run;
+	buf += run;
+	size -= run;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyToUser
+// 	Copy "size" bytes from the kernel buffer "buf" into user memory
+//	at "virtAddr".  Returns FALSE if any of it isn't mapped writable;
+//	the part before the bad page has been copied by then.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::CopyToUser(int virtAddr, char *buf, int size)
+{
+    int physAddr, run;
+
+    while (size > 0) {
+	if ((run = TranslateRun(virtAddr, size, TRUE, &physAddr)) < 0)
+	    return FALSE;
+	bcopy(buf, &(machine->mainMemory[physAddr]), run);
+	virtAddr += run;
+	buf += run;
+	size -= run;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::CopyStringFromUser
+// 	Copy the null-terminated string at "virtAddr" in user memory into
+//	a new kernel buffer, which the caller must delete [].  There is no
+//	limit on the length, other than the end of the address space.
+//
+//	Returns NULL if the string runs into a page that isn't mapped.
+//----------------------------------------------------------------------
+
+char *
+AddrSpace::CopyStringFromUser(int virtAddr)
+{
+    int physAddr, run, length = 0;
+    char *start, *end, *str;
+
+    // find the terminating null, a physically contiguous run at a time
+    for (;;) {
+	run = TranslateRun(virtAddr + length, numPages * PageSize, FALSE,
+								&physAddr);
+	if (run < 0)
+	    return NULL;
+	start = &(machine->mainMemory[physAddr]);
+	if ((end = (char *) memchr(start, '\0', run)) != NULL) {
+	    length += end - start;
+	    break;
+	}
+	length += run;
+    }
+
+    str = new char[length + 1];
+    if (!CopyFromUser(virtAddr, str, length + 1)) {
+	delete [] str;
+	return NULL;
+    }
+    return str;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::IsCopyOnWrite
+// 	Return TRUE if the page holding "virtAddr" is read-only only
+//	because its frame is shared copy-on-write.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::IsCopyOnWrite(int virtAddr)
+{
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+
+    return (vpn < numPages) && copyOnWrite[vpn];
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::BreakCopyOnWrite
+// 	Make the copy-on-write page holding "virtAddr" writable, copying
+//	it into a frame of its own if some other address space still
+//	shares the frame.  The last one left just takes the frame over.
+//
+// Returns:
+//	FALSE if a copy was needed but there are no free frames.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::BreakCopyOnWrite(int virtAddr)
+{
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    int oldFrame, newFrame;
+
+    ASSERT(IsCopyOnWrite(virtAddr));
+    mmLock->Acquire();
+#ifdef USE_TLB
+    tlbManager->Invalidate(this, vpn);
+#endif
+    oldFrame = pageTable[vpn].physicalPage;
+    if (mm->GetRefCount(oldFrame) > 1) {
+#ifdef VM
+	newFrame = pager->AllocateFrame(this, vpn);
+#else
+	if (((newFrame = mm->AllocatePage()) == -1) && textCache->ReclaimIdle())
+	    newFrame = mm->AllocatePage();
+#endif
+	if (newFrame == -1) {
+	    mmLock->Release();
+	    return FALSE;
+	}
+	bcopy(&(machine->mainMemory[oldFrame * PageSize]),
+		&(machine->mainMemory[newFrame * PageSize]), PageSize);
+#ifdef VM
+	pager->ReleaseFrame(oldFrame, this);
+#endif
+	mm->DeallocatePage(oldFrame);
+	pageTable[vpn].physicalPage = newFrame;
+    }
+#ifdef VM
+    else
+	pager->ClaimFrame(oldFrame, this, vpn);
+#endif
+    pageTable[vpn].readOnly = FALSE;
+    copyOnWrite[vpn] = FALSE;
+    mmLock->Release();
+
+    machine->FlushTranslationCache();	// the page table just changed
+    return TRUE;
+}
+
+#ifdef VM
+//----------------------------------------------------------------------
+// LoadSegmentPart
+// 	Read the part of a NOFF segment that falls in one virtual page
+//	into the frame holding that page.
+//
+//	"executable" -- the file to read from
+//	"seg" -- the segment
+//	"pageAddr" -- the virtual address of the start of the page
+//	"page" -- the frame, in mainMemory
+//----------------------------------------------------------------------
+
+static void
+LoadSegmentPart(OpenFile *executable, Segment *seg, int pageAddr, char *page)
+{
+    int start = max(seg->virtualAddr, pageAddr);
+    int end = min(seg->virtualAddr + seg->size, pageAddr + PageSize);
+
+    if (start < end)
+	executable->ReadAt(page + (start - pageAddr), end - start,
+			seg->inFileAddr + (start - seg->virtualAddr));
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::LoadPage
+// 	Fill a free frame with the contents of virtual page "vpn", and map
+//	the page to it.  A page that has been written out to swap is read
+//	back from there.  Otherwise code and initialized data are read
+//	from the executable, and anything else (bss, stack) is zero.  A
+//	page can straddle segment boundaries, so it is zeroed first and
+//	then each segment fills in its part.
+//
+//	The swap slot is kept, so that if the page is evicted again
+//	before it is modified, it needn't be written out.
+//
+//	"vpn" -- the virtual page to load
+//	"frame" -- the physical page to load it into
+//----------------------------------------------------------------------
+
+void
+AddrSpace::LoadPage(unsigned int vpn, int frame)
+{
+    char *page = &(machine->mainMemory[frame * PageSize]);
+
+    DEBUG('a', "Paging in virtual page %d to frame %d\n", vpn, frame);
+    pageTable[vpn].physicalPage = frame;
+    pageTable[vpn].valid = TRUE;
+    pageTable[vpn].use = FALSE;
+    pageTable[vpn].dirty = FALSE;
+    pageTable[vpn].readOnly = FALSE;
+    copyOnWrite[vpn] = FALSE;
+
+    if (swapSlot[vpn] != -1) {
+	pager->swap->ReadPage(swapSlot[vpn], page);
+	return;
+    }
+    bzero(page, PageSize);
+    LoadSegmentPart(executable, &noffH.code, vpn * PageSize, page);
+    LoadSegmentPart(executable, &noffH.initData, vpn * PageSize, page);
+    if (TextCache::IsTextPage(&noffH, vpn)) {	// let others share it
+	pageTable[vpn].readOnly = TRUE;
+	copyOnWrite[vpn] = TRUE;
+	textCache->Insert(fileName, &noffH, vpn, frame);
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ShareText
+// 	If virtual page "vpn" holds nothing but code, and another process
+//	running this program has it in memory, map the same frame,
+//	read-only and copy-on-write, instead of loading a copy.
+//
+// Returns:
+//	FALSE if the page has to be loaded after all.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::ShareText(unsigned int vpn)
+{
+    int frame;
+
+    if (!TextCache::IsTextPage(&noffH, vpn) || (swapSlot[vpn] != -1)
+	    || ((frame = textCache->Lookup(fileName, &noffH, vpn)) == -1))
+	return FALSE;
+
+    DEBUG('a', "Sharing code page %d in frame %d\n", vpn, frame);
+    mm->SharePage(frame);
+    pageTable[vpn].physicalPage = frame;
+    pageTable[vpn].valid = TRUE;
+    pageTable[vpn].use = FALSE;
+    pageTable[vpn].dirty = FALSE;
+    pageTable[vpn].readOnly = TRUE;
+    copyOnWrite[vpn] = TRUE;
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::NeedsSwapSlot, AddrSpace::ReserveSwapSlot
+// 	A modified page can only be evicted if it has a swap slot to be
+//	written to.  The pager asks NeedsSwapSlot while choosing a victim,
+//	and has ReserveSwapSlot find the victim a slot, the first time it
+//	is written out, before anything is done to it.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::NeedsSwapSlot(unsigned int vpn)
+{
+    return pageTable[vpn].dirty && (swapSlot[vpn] == -1);
+}
+
+bool
+AddrSpace::ReserveSwapSlot(unsigned int vpn)
+{
+    if (NeedsSwapSlot(vpn))
+	swapSlot[vpn] = pager->swap->Allocate();
+    return !NeedsSwapSlot(vpn);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::EvictPage
+// 	Take virtual page "vpn" out of memory, at the pager's request.
+//	If it has been modified since it was loaded, write it to the swap
+//	slot ReserveSwapSlot found it, so LoadPage can get it back.
+//	The pager frees the frame.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::EvictPage(unsigned int vpn)
+{
+    ASSERT(pageTable[vpn].valid);
+    if (pageTable[vpn].dirty) {
+	ASSERT(swapSlot[vpn] != -1);
+	DEBUG('a', "Writing virtual page %d to swap slot %d\n", vpn,
+							swapSlot[vpn]);
+	pager->swap->WritePage(swapSlot[vpn],
+		&(machine->mainMemory[pageTable[vpn].physicalPage * PageSize]));
+	stats->numPageWritebacks++;
+    }
+    pageTable[vpn].valid = FALSE;
+}
+#endif // VM
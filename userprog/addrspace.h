@@ -15,20 +15,37 @@
 
 #include "copyright.h"
 #include "filesys.h"
+#include "bitmap.h"
 #include "pcb.h"
+#include "noff.h"
+#include "textcache.h"
 
 #define UserStackSize		1024 	// increase this as necessary!
+#define StackPages	divRoundUp(UserStackSize, PageSize)
+#define MaxStacks		16	// user stacks per address space,
+					// one per thread
 class PCB;
 
 class AddrSpace {
   public:
-    AddrSpace(OpenFile *executable);	// Create an address space,
+    AddrSpace(OpenFile *executableFile, char *executableName);
+					// Create an address space,
 					// initializing it with the program
-					// stored in the file "executable"
-    AddrSpace(AddrSpace* space); // Create an address space,
-          // which is a copy of an existing one
+					// stored in "executableFile"
+					// (named "executableName")
     ~AddrSpace();			// De-allocate an address space
 
+    // An address space is shared by all the threads of a process.
+    int AddReference();			// Another thread is using it
+    int RemoveReference();		// A thread is done with it; returns
+					// the number still using it
+
+    int AllocateStack();		// Map a fresh user stack for a new
+					// thread; returns its slot, or -1
+    void FreeStack(int slot);		// Unmap a thread's stack
+    int StackTop(int slot);		// Top of the stack in "slot"; slot 0
+					// is the first thread's
+
     void InitRegisters();		// Initialize user-level CPU registers,
 					// before jumping to user code
 
@@ -37,7 +54,40 @@ class AddrSpace {
     unsigned int GetNumPages(); // get size of addr space
     TranslationEntry* GetPageTable(); // return pageTable
     unsigned int Translate(unsigned int virtualAddr);
-    PCB* pcb; // the process that owns this addresspace
+
+    // Kernel access to user memory, a page-contiguous run at a time.
+    // These return FALSE (or -1, or NULL) if part of the range isn't
+    // mapped, rather than raising an exception.
+    int TranslateRun(int virtAddr, int size, bool writing, int *physAddr);
+					// How many bytes at virtAddr are
+					// physically contiguous, and where?
+    bool CopyFromUser(int virtAddr, char *buf, int size);
+    bool CopyToUser(int virtAddr, char *buf, int size);
+    char *CopyStringFromUser(int virtAddr);
+					// Copy a null-terminated string
+					// into a new kernel buffer
+
+    bool IsCopyOnWrite(int virtAddr);	// Is this page shared copy-on-write?
+    bool BreakCopyOnWrite(int virtAddr);
+					// Give this address space its own
+					// writable copy of a shared page;
+					// FALSE if there is no free frame
+
+#ifdef VM
+    void LoadPage(unsigned int vpn, int frame);
+					// Fill a frame with the contents of
+					// a virtual page, from swap or the
+					// executable, and map the page to it
+    bool NeedsSwapSlot(unsigned int vpn);
+					// Is the page modified, with no swap
+					// slot to write it to yet?
+    bool ReserveSwapSlot(unsigned int vpn);
+					// Find it one; FALSE if swap is full
+    void EvictPage(unsigned int vpn);	// Unmap a page, writing it to swap
+					// first if it has been modified
+    bool ShareText(unsigned int vpn);	// Map a code page another process
+					// already has in memory
+#endif
     bool valid; // is AddrSpace valid
     
 
@@ -47,6 +97,35 @@ class AddrSpace {
 					// for now!
     unsigned int numPages;		// Number of pages in the virtual
 					// address space
+    bool *copyOnWrite;			// For each page, is it mapped
+					// read-only only because its frame
+					// is shared with another process?
+
+    bool Accessible(unsigned int vpn, bool writing);
+					// Can the kernel touch this page now?
+    bool MakeAccessible(unsigned int vpn, bool writing);
+					// Page it in, or copy it, if need be
+					// so the kernel can touch it
+
+    int refCount;			// Threads using this address space
+    unsigned int basePages;		// Pages of the program and its
+					// first stack; the other stacks
+					// follow
+    BitMap *stackSlots;			// Which stacks are in use
+    void GrowPageTable(unsigned int n);	// Make room for "n" pages
+    bool MapZeroPage(unsigned int vpn);	// Map a page of a new stack
+    void UnmapPage(unsigned int vpn);	// Give up a page of an old stack
+
+#ifdef VM
+    char *fileName;			// Name of the executable, for the
+					// code page cache
+    OpenFile *executable;		// Where code and initialized data
+					// pages are paged in from
+    NoffHeader noffH;			// Where they are in the executable
+    int *swapSlot;			// For each page, the swap slot
+					// holding its contents, or -1 if
+					// it has never been written out
+#endif
     
 };
 
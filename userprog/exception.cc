@@ -53,23 +53,39 @@
 //----------------------------------------------------------------------
 
 
+// Take a thread out of its address space: free its stack, or delete
+// the whole address space if no other thread is using it.
+void releaseSpace(Thread* thread, PCB* pcb) {
+
+    AddrSpace* space = thread->space;
+
+    if (space->RemoveReference() == 0)
+        delete space;
+    else if (pcb->stackSlot != 0)
+        space->FreeStack(pcb->stackSlot);
+    thread->space = NULL;
+}
+
 void doExit(int status) {
     
-    printf("System Call: [%d] invoked Exit\n", currentThread->space->pcb->pid);
+    printf("System Call: [%d] invoked Exit\n", currentThread->pcb->pid);
     
-    // Manage PCB memory As a parent process
-    PCB* pcb = currentThread->space->pcb;
-
-    // Delete exited children and set parent null for non-exited ones
-    pcb->DeleteExitedChildrenSetParentNull();
-
-    // Manage PCB memory As a child process
-    printf ("Process [%d] exits with [%d]\n", currentThread->space->pcb->pid, status);
-    if(pcb->parent == NULL) pcbManager->DeallocatePCB(pcb);
+    PCB* pcb = currentThread->pcb;
 
+    // Close any files left open, unless other threads of the process
+    // are still using them
+    pcb->ReleaseFiles();
 
     // Delete address space only after use is completed
-    delete currentThread->space;
+    releaseSpace(currentThread, pcb);
+
+    // Free exited children, and tell the parent (waking it if it is in
+    // Join).  The PCB may be freed by the time Exit returns.
+    printf ("Process [%d] exits with [%d]\n", pcb->pid, status);
+    joinLock->Acquire();
+    pcb->Exit(status);
+    joinLock->Release();
+    currentThread->pcb = NULL;
 
     // Finish current thread only after all the cleanup is done
     // because currentThread marks itself to be destroyed (by a different thread)
@@ -90,11 +106,14 @@ void incrementPC() {
 
 void childFunction(int pid) {
 
-    // 1. Restore the state of registers
+    // 1. Restore the state of registers, once the thread whose
+    // registers are still in the machine (our parent, usually) has
+    // had them saved -- we start in ThreadRoot, not in Scheduler::Run
+    scheduler->ClaimUserRegisters();
     currentThread->RestoreUserState();
 
     // 2. Restore the page table for child
-    currentThread->space->RestoreState();
+    scheduler->LoadSpace(currentThread->space);
 
     //PCReg == machine->ReadRegister(PCReg);
     //machine->WriteRegister(pid,  PCReg, currentThread->space->GetNumPages());
@@ -104,72 +123,61 @@ void childFunction(int pid) {
 
 int doFork(int functionAddr) {
 
-    unsigned int oldPC, oldPrevPC, oldNextPC;
-    unsigned int index;
+    AddrSpace *space = currentThread->space;
+    PCB *pcb = currentThread->pcb;
+    int slot;
 
-    printf("System Call: [%d] invoked Fork.\n", currentThread->space->pcb->pid);
+    printf("System Call: [%d] invoked Fork.\n", pcb->pid);
 
-    // 1. Check if sufficient memory exists to create new process
-    // if check fails, return -1
-    
-    if (!(currentThread->space->GetNumPages() <= mm->GetFreePageCount())){
-        machine->WriteRegister(2, -1);
+    // 1. The child is a new thread in the same address space, so all
+    // it needs is a stack of its own
+    if ((slot = space->AllocateStack()) == -1) {
+        printf("Process [%d] Fork: no room for another stack\n", pcb->pid);
         return -1;
     }
+    space->AddReference();
 
     // 2. SaveUserState for the parent thread
     currentThread->SaveUserState();
 
-    // 3. Create a new address space for child by copying parent address space
-    //parent = currentThread->space;
-    
-    AddrSpace *childAddrSpace = new AddrSpace(currentThread->space);
-
-    // 4. Create a new thread for the child and set its addrSpace
+    // 3. Create a new thread for the child, sharing the address space
     Thread *childThread = new Thread("childThread");
-    childThread->space = childAddrSpace;
+    childThread->space = space;
 
-    // 5. Create a PCB for the child and connect it all up
+    // 4. Create a PCB for the child and connect it all up
     PCB *childpcb = pcbManager->AllocatePCB();
     childpcb->thread = childThread;
-    childAddrSpace->pcb = childpcb;
+    childpcb->stackSlot = slot;
+    childpcb->ShareFiles(pcb);      // and the same open files
+    childThread->pcb = childpcb;
     
     // set parent for child pcb
-    childpcb->parent = currentThread->space->pcb;
+    childpcb->parent = pcb;
     // add child for parent pcb
-    currentThread->space->pcb->AddChild(childpcb);
-    
-    mmLock->Acquire();
-    // 6. Set up machine registers for child and save it to child thread
-    oldPC = machine->ReadRegister(PCReg);
-    oldPrevPC = machine->ReadRegister(PrevPCReg);
-    oldNextPC = machine->ReadRegister(NextPCReg);
-    index = oldPC;
-    machine->WriteRegister(PCReg, machine->ReadRegister(4)); 
-    machine->WriteRegister(PrevPCReg, machine->ReadRegister(4)-4); 
-    machine->WriteRegister(NextPCReg, machine->ReadRegister(4)+4); 
+    pcb->AddChild(childpcb);
+
+    // 5. Set up machine registers for child and save it to child thread:
+    // start at the function, on the new stack
+    machine->WriteRegister(PCReg, functionAddr);
+    machine->WriteRegister(PrevPCReg, functionAddr - 4);
+    machine->WriteRegister(NextPCReg, functionAddr + 4);
+    machine->WriteRegister(StackReg, space->StackTop(slot) - 16);
 
     childThread->SaveUserState(); 
-    
-    // 7. Restore register state of parent user-level process
 
-    // 8. Call thread->fork on Child
+    // 6. Call thread->fork on Child
     childThread->Fork(childFunction, 1);
-    printf("Process [%d] Fork: start at address [0x%x] with [%d] pages memory\n", currentThread->space->pcb->pid, machine->ReadRegister(4), currentThread->space->GetNumPages());
+    printf("Process [%d] Fork: start at address [0x%x] with stack [%d]\n", pcb->pid, functionAddr, slot);
    
-    machine->WriteRegister(PCReg, oldPC); 
-    machine->WriteRegister(PrevPCReg, oldPrevPC); 
-    machine->WriteRegister(NextPCReg, oldNextPC); 
-
+    // 7. Restore register state of parent user-level process
     currentThread->RestoreUserState();
     machine->WriteRegister(2, childpcb->pid);
 
-    mmLock->Release();
     return childpcb->pid;
 }
 
 int doExec(char* filename) {
-    printf("System Call: [%d] invoked Exec\n", currentThread->space->pcb->pid);
+    printf("System Call: [%d] invoked Exec\n", currentThread->pcb->pid);
 
     // Use progtest.cc:StartProcess() as a guide
 
@@ -179,31 +187,30 @@ int doExec(char* filename) {
 
     if (executable == NULL) {
         printf("Unable to open file %s\n", filename);
+        delete [] filename;
         incrementPC();
         machine->WriteRegister(2,-1);
         return -1;
     }
-    // 6. Delete current address space
-    PCB* pcb = currentThread->space->pcb;
-    delete currentThread->space;
+    // 6. Leave the current address space (deleting it, unless other
+    // threads of the process are still running in it)
+    PCB* pcb = currentThread->pcb;
+    releaseSpace(currentThread, pcb);
 
     // 2. Create new address space
-    space = new AddrSpace(executable);
+    space = new AddrSpace(executable, filename);
 
     // 3. Check if Addrspace creation was successful
     if(space->valid != true) {
         printf("Could not create AddrSpace\n");
+        delete [] filename;
         incrementPC();
         return -1;
     }
 
-    // Steps 4 and 5 may not be necessary!!
-
-    // 4. Create a new PCB for the new addrspace
-    // ?. Can you reuse existing pcb?
-    
-    // Initialize parent
-    space->pcb = pcb;
+    // 4. Keep the thread's PCB, and its open files; it runs on the
+    // first stack of the new address space
+    pcb->stackSlot = 0;
 
     // 5. Set the thread for the new pcb
     pcb->thread = currentThread;
@@ -215,13 +222,15 @@ int doExec(char* filename) {
     delete executable;
 
     // 9. Initialize registers for new addrspace
+    scheduler->ClaimUserRegisters();
     space->InitRegisters();		// set the initial register values
 
     // 10. Initialize the page table
-    space->RestoreState();		// load page table register
+    scheduler->LoadSpace(space);	// load page table register
 
     // 11. Run the machine now that all is set up
-    printf("Exec Program: [%d] loading [%s]\n", currentThread->space->pcb->pid, filename);
+    printf("Exec Program: [%d] loading [%s]\n", currentThread->pcb->pid, filename);
+    delete [] filename;			// Run never returns
     machine->Run();			// jump to the user progam
     ASSERT(FALSE); // Execution nevere reaches here
 
@@ -231,31 +240,43 @@ int doExec(char* filename) {
 
 int doJoin(int pid) {
 
+    PCB* pcb = currentThread->pcb;
+
+    joinLock->Acquire();
 
-    PCB* joinPCB = pcbManager->GetPCB(currentThread->space->pcb->pid);
-    if (joinPCB == NULL) {
     // 1. Check if this is a valid pid and return -1 if not
-        return -1;
-    }
+    PCB* joinPCB = pcbManager->GetPCB(pid);
 
     // 2. Check if pid is a child of current process
-    PCB* pcb = currentThread->space->pcb;
-    if (pcb != joinPCB->parent) {
+    if (joinPCB == NULL || pcb != joinPCB->parent) {
+        joinLock->Release();
         return -1;
     }
 
-    // 3. Yield until joinPCB has not exited
+    // 3. Sleep until joinPCB has exited, then free it
+    int status = pcb->Join(joinPCB);
 
-    while(!joinPCB->HasExited()) {
-        currentThread->Yield();
-    }
+    joinLock->Release();
+    return status;
+
+}
 
-    // 4. Store status and delete joinPCB
-    int status = joinPCB->exitStatus;
-    delete joinPCB;
+int doJoinAny(int statusAddr) {
 
-    return status;
+    PCB* pcb = currentThread->pcb;
+    int status, pid;
 
+    // Sleep until some child has exited, and free it
+    joinLock->Acquire();
+    pid = pcb->JoinAny(&status);
+    joinLock->Release();
+
+    // Hand back its exit status too, if asked
+    if (pid != -1 && statusAddr != 0) {
+        status = WordToMachine(status);
+        currentThread->space->CopyToUser(statusAddr, (char*)&status, sizeof(int));
+    }
+    return pid;
 }
 
 
@@ -266,30 +287,42 @@ int doKill (int pid) {
     if (pcb == NULL) return -1;
 
     // 2. IF pid is self, then just exit the process
-    if (pcb == currentThread->space->pcb) {
+    if (pcb == currentThread->pcb) {
            doExit(0);
            return 0;
     }
 
-    // 3. Valid kill, pid exists and not self, do cleanup similar to Exit
+    // 3. Take the target thread off the ready lists, so it never runs
+    // again.  A thread blocked inside the kernel can't be torn down
+    // safely (it is on some synchronization variable's queue), so
+    // refuse to kill it.
+    Thread* thread = pcb->thread;
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    bool removed = scheduler->RemoveThread(thread);
+    (void) interrupt->SetLevel(oldLevel);
+    if (!removed) return -1;
+
+    // 4. Valid kill, pid exists and not self, do cleanup similar to Exit
     // However, change references from currentThread to the target thread
     // pcb->thread is the target thread
-    pcb->DeleteExitedChildrenSetParentNull();
-    pcbManager->DeallocatePCB(pcb);
-    delete pcb->thread->space;
-    pcb->thread->Finish();
+    pcb->ReleaseFiles();
+    releaseSpace(thread, pcb);
+    joinLock->Acquire();
+    pcb->Exit(-1);
+    joinLock->Release();
+    thread->pcb = NULL;
 
-    // 4. Set thread to be destroyed.
-    scheduler->RemoveThread(pcb->thread);
+    // 5. It isn't running, so it can be destroyed right away
+    delete thread;
 
-    // 5. return 0 for success!
+    // 6. return 0 for success!
     return 0;
 }
 
 
 
 void doYield() {
-    printf("System Call: [%d] invoked Yield.\n", currentThread->space->pcb->pid);
+    printf("System Call: [%d] invoked Yield.\n", currentThread->pcb->pid);
     currentThread->Yield();
 }
 
@@ -309,35 +342,136 @@ char* readString1(int virtAddr) {
 
 }
 
+// The correct way is AddrSpace::CopyStringFromUser, which translates
+// once per page and has no length limit.
 
-// This implementation is correct!
-// perform MMU translation to access physical memory
-char* readString(int virtualAddr) {
-    int i = 0;
-    char* str = new char[256];
-    unsigned int physicalAddr = currentThread->space->Translate(virtualAddr);
-
-    // Need to get one byte at a time since the string may straddle multiple pages that are not guaranteed to be contiguous in the physicalAddr space
-    bcopy(&(machine->mainMemory[physicalAddr]),&str[i],1);
-    while(str[i] != '\0' && i != 256-1)
-    {
-        virtualAddr++;
-        i++;
-        physicalAddr = currentThread->space->Translate(virtualAddr);
-        bcopy(&(machine->mainMemory[physicalAddr]),&str[i],1);
-    }
-    if(i == 256-1 && str[i] != '\0')
-    {
-        str[i] = '\0';
+void doCreate(char* fileName)
+{
+    printf("Syscall Call: [%d] invoked Create.\n", currentThread->pcb->pid);
+    fileSystem->Create(fileName, 0);
+    delete [] fileName;
+}
+
+int doOpen(char* fileName)
+{
+    printf("System Call: [%d] invoked Open.\n", currentThread->pcb->pid);
+    OpenFile* file = fileSystem->Open(fileName);
+    delete [] fileName;
+    if (file == NULL) return -1;
+
+    int id = currentThread->pcb->AddFile(file);
+    if (id == -1) delete file;      // too many open files
+    return id;
+}
+
+void doClose(int id)
+{
+    printf("System Call: [%d] invoked Close.\n", currentThread->pcb->pid);
+    currentThread->pcb->CloseFile(id);
+}
+
+// The console device is only started once a program uses it, because
+// from then on it keeps polling for input, and Nachos never goes idle.
+SynchConsole* getConsole()
+{
+    if (synchConsole == NULL)
+        synchConsole = new SynchConsole(NULL, NULL);
+    return synchConsole;
+}
+
+// Read and Write move data straight between a file and the frames
+// holding the user's buffer, one physically contiguous run at a time,
+// so there is no kernel buffer in between.  That is only safe while the
+// transfer can't block: otherwise other threads run meanwhile, and may
+// page our frames out and hand them to someone else.  So the console,
+// and the real file system (which waits for the disk), go through a
+// kernel buffer instead.
+int doRead(int virtAddr, int size, int id)
+{
+    AddrSpace* space = currentThread->space;
+    int numRead = 0, run, n;
+#ifdef FILESYS
+    char buf[PageSize];
+    int position;
+#else
+    int physAddr;
+#endif
+
+    if (size < 0) return -1;
+
+    if (id == ConsoleInput) {
+        // A device: wait for at least one character, and return the
+        // rest of the line if there is room for it.
+        while (numRead < size) {
+            char ch = getConsole()->GetChar();
+            if (!space->CopyToUser(virtAddr + numRead, &ch, 1)) return -1;
+            numRead++;
+            if (ch == '\n') break;
+        }
+        return numRead;
     }
 
-    return str;
+    OpenFile* file = currentThread->pcb->GetFile(id);
+    if (file == NULL) return -1;
+
+    while (numRead < size) {
+#ifdef FILESYS
+        // If the bytes can't be delivered, put them back, so the next
+        // Read gets them
+        run = min(size - numRead, PageSize);
+        position = file->Tell();
+        n = file->Read(buf, run);
+        if (n > 0 && !space->CopyToUser(virtAddr + numRead, buf, n)) {
+            file->Seek(position);
+            return numRead > 0 ? numRead : -1;
+        }
+#else
+        run = space->TranslateRun(virtAddr + numRead, size - numRead, TRUE, &physAddr);
+        if (run < 0) return numRead > 0 ? numRead : -1;
+        n = file->Read(&(machine->mainMemory[physAddr]), run);
+#endif
+        numRead += n;
+        if (n < run) break;         // end of file
+    }
+    return numRead;
 }
 
-void doCreate(char* fileName)
+int doWrite(int virtAddr, int size, int id)
 {
-    printf("Syscall Call: [%d] invoked Create.\n", currentThread->space->pcb->pid);
-    fileSystem->Create(fileName, 0);
+    AddrSpace* space = currentThread->space;
+    int numWritten = 0, run;
+#ifndef FILESYS
+    int physAddr;
+#endif
+    OpenFile* file = NULL;
+    char buf[PageSize];
+
+    if (size < 0) return -1;
+    if (id != ConsoleOutput && (file = currentThread->pcb->GetFile(id)) == NULL) return -1;
+
+    while (numWritten < size) {
+#ifndef FILESYS
+        if (file != NULL) {
+            run = space->TranslateRun(virtAddr + numWritten, size - numWritten, FALSE, &physAddr);
+            if (run < 0) return numWritten > 0 ? numWritten : -1;
+            file->Write(&(machine->mainMemory[physAddr]), run);
+            numWritten += run;
+            continue;
+        }
+#endif
+        // The console blocks for each character, and the real file
+        // system for each sector, and other processes may page our
+        // frames out meanwhile, so write from a copy
+        run = min(size - numWritten, PageSize);
+        if (!space->CopyFromUser(virtAddr + numWritten, buf, run))
+            return numWritten > 0 ? numWritten : -1;
+        if (file == NULL)
+            getConsole()->Write(buf, run);
+        else
+            file->Write(buf, run);
+        numWritten += run;
+    }
+    return numWritten;
 }
 
 void
@@ -358,14 +492,20 @@ ExceptionHandler(ExceptionType which)
         incrementPC();
     } else if ((which == SyscallException) && (type == SC_Exec)) {
         int virtAddr = machine->ReadRegister(4);
-        char* fileName = readString(virtAddr);
-        int ret = doExec(fileName);
+        char* fileName = currentThread->space->CopyStringFromUser(virtAddr);
+        int ret = -1;
+        if (fileName != NULL)
+            ret = doExec(fileName);
         machine->WriteRegister(2, ret);
         incrementPC();
     } else if ((which == SyscallException) && (type == SC_Join)) {
         int ret = doJoin(machine->ReadRegister(4));
         machine->WriteRegister(2, ret);
         incrementPC();
+    } else if ((which == SyscallException) && (type == SC_JoinAny)) {
+        int ret = doJoinAny(machine->ReadRegister(4));
+        machine->WriteRegister(2, ret);
+        incrementPC();
     } else if ((which == SyscallException) && (type == SC_Kill)) {
         int ret = doKill(machine->ReadRegister(4));
         machine->WriteRegister(2, ret);
@@ -375,9 +515,48 @@ ExceptionHandler(ExceptionType which)
         incrementPC();
     } else if((which == SyscallException) && (type == SC_Create)) {
         int virtAddr = machine->ReadRegister(4);
-        char* fileName = readString(virtAddr);
-        doCreate(fileName);
+        char* fileName = currentThread->space->CopyStringFromUser(virtAddr);
+        if (fileName != NULL)
+            doCreate(fileName);
+        incrementPC();
+    } else if((which == SyscallException) && (type == SC_Open)) {
+        int virtAddr = machine->ReadRegister(4);
+        char* fileName = currentThread->space->CopyStringFromUser(virtAddr);
+        int ret = -1;
+        if (fileName != NULL)
+            ret = doOpen(fileName);
+        machine->WriteRegister(2, ret);
+        incrementPC();
+    } else if((which == SyscallException) && (type == SC_Read)) {
+        int ret = doRead(machine->ReadRegister(4), machine->ReadRegister(5), machine->ReadRegister(6));
+        machine->WriteRegister(2, ret);
+        incrementPC();
+    } else if((which == SyscallException) && (type == SC_Write)) {
+        int ret = doWrite(machine->ReadRegister(4), machine->ReadRegister(5), machine->ReadRegister(6));
+        machine->WriteRegister(2, ret);
+        incrementPC();
+    } else if((which == SyscallException) && (type == SC_Close)) {
+        doClose(machine->ReadRegister(4));
         incrementPC();
+    } else if ((which == ReadOnlyException) &&
+               currentThread->space->IsCopyOnWrite(machine->ReadRegister(BadVAddrReg))) {
+        // First write to a copy-on-write page (shared code, or the
+        // zero frame).  Don't increment the PC: the store is simply
+        // tried again.
+        if (!currentThread->space->BreakCopyOnWrite(machine->ReadRegister(BadVAddrReg))) {
+            printf("Process [%d] out of memory for copy-on-write\n", currentThread->pcb->pid);
+            doExit(-1);
+        }
+#ifdef VM
+    } else if (which == PageFaultException) {
+        // First touch of a page that isn't in memory.  Don't increment
+        // the PC: the instruction is simply tried again.
+        if (!pager->HandlePageFault(machine->ReadRegister(BadVAddrReg))) {
+            printf("Process [%d] page fault at 0x%x could not be handled\n",
+                   currentThread->pcb->pid, machine->ReadRegister(BadVAddrReg));
+            doExit(-1);
+        }
+#endif
     } else {
 	printf("Unexpected user mode exception %d %d\n", which, type);
 	ASSERT(FALSE);
@@ -1,10 +1,16 @@
 #include "memorymanager.h"
 #include "machine.h"
+#include "system.h"
 
 
 MemoryManager::MemoryManager() {
 
     bitmap = new BitMap(NumPhysPages);
+    refCount = new int[NumPhysPages];
+    for(int i = 0; i < NumPhysPages; i++) {
+        refCount[i] = 0;
+    }
+    zeroPage = -1;
 
 }
 
@@ -12,13 +18,23 @@ MemoryManager::MemoryManager() {
 MemoryManager::~MemoryManager() {
 
     delete bitmap;
+    delete [] refCount;
 
 }
 
 
 int MemoryManager::AllocatePage() {
 
-    return bitmap->Find();
+    int page = bitmap->Find();
+
+    // The caller is about to fill the frame directly, so any
+    // instructions the simulator decoded from its old contents are stale
+    if (page != -1) {
+        machine->InvalidateCode(page);
+        refCount[page] = 1;
+    }
+
+    return page;
 
 }
 
@@ -26,12 +42,26 @@ int MemoryManager::DeallocatePage(int which) {
 
     if(bitmap->Test(which) == false) return -1;
     else {
-        bitmap->Clear(which);
+        // Only free the frame once nobody is sharing it
+        if(--refCount[which] == 0) bitmap->Clear(which);
         return 0;
     }
 
 }
 
+void MemoryManager::SharePage(int which) {
+
+    ASSERT(bitmap->Test(which));
+    refCount[which]++;
+
+}
+
+int MemoryManager::GetRefCount(int which) {
+
+    return refCount[which];
+
+}
+
 
 unsigned int MemoryManager::GetFreePageCount() {
 
@@ -39,3 +69,15 @@ unsigned int MemoryManager::GetFreePageCount() {
 
 }
 
+int MemoryManager::GetZeroPage() {
+
+    // Allocated the first time it's needed, and then kept for good: the
+    // reference taken here is never dropped, so every page table entry
+    // mapping it can drop its own.  Returns -1 if memory is full.
+    if (zeroPage == -1 && (zeroPage = AllocatePage()) != -1)
+        bzero(&(machine->mainMemory[zeroPage * PageSize]), PageSize);
+
+    return zeroPage;
+
+}
+
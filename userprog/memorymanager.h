@@ -9,12 +9,20 @@ class MemoryManager {
         MemoryManager();
         ~MemoryManager();
 
-        int AllocatePage();
-        int DeallocatePage(int which);
+        int AllocatePage();             // reference count starts at 1
+        int DeallocatePage(int which);  // drop a reference; the frame is
+                                        // freed when the last one goes
+        void SharePage(int which);      // add a reference to a frame
+        int GetRefCount(int which);
         unsigned int GetFreePageCount();
+        int GetZeroPage();              // a frame of zeros, shared by
+                                        // everyone, never to be written
 
     private:
         BitMap *bitmap;
+        int *refCount;      // number of page table entries mapping
+                            // each frame (copy-on-write sharing)
+        int zeroPage;       // the zero frame, or -1 until first used
 
 };
 
@@ -1,41 +1,189 @@
 #include "pcb.h"
+#include "synch.h"
 
 
 PCB::PCB(int id) {
 
     pid = id;
     parent = NULL;
-    children = new List();
+    children = new IntrusiveList();
+    exitedChildren = new IntrusiveList();
+    siblingLink.item = this;
+    exitedLink.item = this;
+    childExited = new Condition("childExited");
     thread = NULL;
     exitStatus = -9999;
+    stackSlot = 0;
+    files = new FileTable();
 }
 
 PCB::~PCB() {
 
+    ReleaseFiles();
     delete children;
+    delete exitedChildren;
+    delete childExited;
 }
 
 void PCB::AddChild(PCB* pcb) {
 
-    children->Append(pcb);
+    children->Append(&pcb->siblingLink);
 }
 
 int PCB::RemoveChild(PCB* pcb){
 
-    return children->RemoveItem(pcb);
+    if (pcb->siblingLink.list != children) return -1;
+    children->RemoveLink(&pcb->siblingLink);
+    return 0;
 }
 
 bool PCB::HasExited() {
     return exitStatus == -9999 ? false : true;
 }
 
-void decspn(int arg) {
-    PCB* pcb = (PCB*)arg;
-    if (pcb->HasExited()) pcbManager->DeallocatePCB(pcb);
-    else pcb->parent = NULL;
+void PCB::DeleteExitedChildrenSetParentNull() {
+
+    PCB* child;
+    while ((child = (PCB*)children->Remove()) != NULL) {
+        if (child->exitedLink.IsLinked())
+            exitedChildren->RemoveLink(&child->exitedLink);
+        if (child->HasExited()) pcbManager->DeallocatePCB(child);
+        else child->parent = NULL;
+    }
 }
 
 
-void PCB::DeleteExitedChildrenSetParentNull() {
-    children->Mapcar(decspn);
-}
\ No newline at end of file
+void PCB::Exit(int status) {
+
+    ASSERT(joinLock->isHeldByCurrentThread());
+    DeleteExitedChildrenSetParentNull();
+    exitStatus = status;
+    if (parent != NULL) {
+        parent->exitedChildren->Append(&exitedLink);
+        parent->childExited->Broadcast(joinLock);
+    } else {
+        pcbManager->DeallocatePCB(this);    // nobody will Join us
+    }
+}
+
+int PCB::Join(PCB* child) {
+
+    ASSERT(joinLock->isHeldByCurrentThread());
+    while (!child->HasExited()) {
+        childExited->Wait(joinLock);
+    }
+    int status = child->exitStatus;
+    Reap(child);
+    return status;
+}
+
+int PCB::JoinAny(int* status) {
+
+    ASSERT(joinLock->isHeldByCurrentThread());
+    while (exitedChildren->IsEmpty()) {
+        if (children->IsEmpty()) return -1;
+        childExited->Wait(joinLock);
+    }
+    PCB* child = (PCB*)exitedChildren->Remove();
+    int childPid = child->pid;
+    *status = child->exitStatus;
+    Reap(child);
+    return childPid;
+}
+
+void PCB::Reap(PCB* child) {
+
+    children->RemoveLink(&child->siblingLink);
+    if (child->exitedLink.IsLinked())
+        exitedChildren->RemoveLink(&child->exitedLink);
+    pcbManager->DeallocatePCB(child);
+}
+
+
+int PCB::AddFile(OpenFile* file) {
+
+    ASSERT(files != NULL);
+    return files->Add(file);
+}
+
+OpenFile* PCB::GetFile(int id) {
+
+    if(files == NULL) return NULL;
+    return files->Get(id);
+}
+
+int PCB::CloseFile(int id) {
+
+    if(files == NULL) return -1;
+    return files->Close(id);
+}
+
+void PCB::ShareFiles(PCB* pcb) {
+
+    ReleaseFiles();
+    files = pcb->files;
+    files->AddReference();
+}
+
+void PCB::ReleaseFiles() {
+
+    if(files == NULL) return;
+    if(files->RemoveReference() == 0) delete files;
+    files = NULL;
+}
+
+
+FileTable::FileTable() {
+
+    refCount = 1;
+    for(int i = 0; i < MaxOpenFiles; i++) {
+        openFiles[i] = NULL;
+    }
+}
+
+FileTable::~FileTable() {
+
+    ASSERT(refCount == 0);
+    for(int i = 2; i < MaxOpenFiles; i++) {
+        Close(i);
+    }
+}
+
+int FileTable::AddReference() {
+
+    return ++refCount;
+}
+
+int FileTable::RemoveReference() {
+
+    ASSERT(refCount > 0);
+    return --refCount;
+}
+
+int FileTable::Add(OpenFile* file) {
+
+    // Skip ConsoleInput and ConsoleOutput
+    for(int i = 2; i < MaxOpenFiles; i++) {
+        if(openFiles[i] == NULL) {
+            openFiles[i] = file;
+            return i;
+        }
+    }
+    return -1;
+}
+
+OpenFile* FileTable::Get(int id) {
+
+    if(id < 2 || id >= MaxOpenFiles) return NULL;
+    return openFiles[id];
+}
+
+int FileTable::Close(int id) {
+
+    OpenFile* file = Get(id);
+    if(file == NULL) return -1;
+
+    delete file;
+    openFiles[id] = NULL;
+    return 0;
+}
@@ -3,10 +3,37 @@
 
 #include "list.h"
 #include "pcbmanager.h"
+#include "openfile.h"
+
+#define MaxOpenFiles 16     // per process, including the two console ids
 
 class Thread;
 class PCBManager;
+class Condition;
+class Lock;
 extern PCBManager* pcbManager;
+extern Lock* joinLock;      // protects parent/child links and exit status
+
+// Open file table.  Ids 0 and 1 are ConsoleInput and ConsoleOutput,
+// which are never in the table.  All the threads a process Forks share
+// one table; it is closed when the last of them lets go of it.
+class FileTable {
+
+    public:
+        FileTable();
+        ~FileTable();               // closes whatever is still open
+
+        int AddReference();         // another thread is using it
+        int RemoveReference();      // returns the number still using it
+
+        int Add(OpenFile* file);    // returns the new id, or -1
+        OpenFile* Get(int id);      // NULL if id isn't open
+        int Close(int id);          // returns 0, or -1 if not open
+
+    private:
+        int refCount;
+        OpenFile* openFiles[MaxOpenFiles];
+};
 
 class PCB {
 
@@ -17,14 +44,40 @@ class PCB {
         PCB* parent;
         Thread* thread;
         int exitStatus;
+        int stackSlot;      // the thread's stack in its address space
+        ListLink siblingLink;   // on the parent's children list
+        ListLink exitedLink;    // on the parent's exitedChildren list
 
         void AddChild(PCB* pcb);
         int RemoveChild(PCB* pcb);
         bool HasExited();
         void DeleteExitedChildrenSetParentNull();
 
+        // Exit and Join.  These must be called with joinLock held.
+        void Exit(int status);      // record the status and wake the
+                                    // parent; frees the PCB if there
+                                    // is no parent to collect it
+        int Join(PCB* child);       // wait for a child to exit, free
+                                    // its PCB, and return its status
+        int JoinAny(int* status);   // the same for whichever child
+                                    // exits first; returns its pid, or
+                                    // -1 if there are no children
+
+        // Open files, in the table shared with the rest of the process
+        int AddFile(OpenFile* file);    // returns the new id, or -1
+        OpenFile* GetFile(int id);      // NULL if id isn't open
+        int CloseFile(int id);          // returns 0, or -1 if not open
+        void ShareFiles(PCB* pcb);      // use pcb's table (for Fork)
+        void ReleaseFiles();            // let go of the table, closing
+                                        // it if we were the last user
+
     private:
-        List* children;
+        IntrusiveList* children;
+        IntrusiveList* exitedChildren;  // children waiting to be joined
+        Condition* childExited;     // signalled when a child exits
+        FileTable* files;           // NULL once released
+
+        void Reap(PCB* child);
 
 };
 
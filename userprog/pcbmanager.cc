@@ -3,11 +3,12 @@
 #include "pcbmanager.h"
 
 
-PCBManager::PCBManager(int maxProcesses) {
+PCBManager::PCBManager(int numProcesses) {
 
+    maxProcesses = numProcesses;
     bitmap = new BitMap(maxProcesses);
     pcbs = new PCB*[maxProcesses];
-    pcbManagerLock = new Lock("pcbManagerLock");
+    pcbManagerLock = new RWLock("pcbManagerLock", PreferWriters);
     //printf("pcbs.size() = %d\n", sizeof(pcbs));
 
     for(int i = 0; i < maxProcesses; i++) {
@@ -22,27 +23,27 @@ PCBManager::~PCBManager() {
     delete bitmap;
 
     delete pcbs;
+    delete pcbManagerLock;
 
 }
 
 
 PCB* PCBManager::AllocatePCB() {
 
-    // Aquire pcbManagerLock
-
-    pcbManagerLock->Acquire();
+    // Aquire pcbManagerLock; we're changing the table
+    pcbManagerLock->AcquireWrite();
 
     int pid = bitmap->Find();
 
-    // Release pcbManagerLock
-    pcbManagerLock->Release();
-   
-
     ASSERT(pid != -1);
 
-    pcbs[pid] = new PCB(pid);
+    PCB* pcb = new PCB(pid);
+    pcbs[pid] = pcb;
 
-    return pcbs[pid];
+    // Release pcbManagerLock
+    pcbManagerLock->ReleaseWrite();
+
+    return pcb;
 
 }
 
@@ -52,21 +53,26 @@ int PCBManager::DeallocatePCB(PCB* pcb) {
     // Check is pcb is valid -- check pcbs for pcb->pid
     ASSERT(pcb->pid != -1);
 
-    // Aquire pcbManagerLock
-    pcbManagerLock->Acquire();
-
-    bitmap->Clear(pcb->pid);
-
-    // Release pcbManagerLock
-    pcbManagerLock->Release();
+    // Aquire pcbManagerLock; we're changing the table
+    pcbManagerLock->AcquireWrite();
 
     int pID = pcb->pid;
-    delete pcbs[pcb->pid];
-
+    bitmap->Clear(pID);
+    delete pcbs[pID];
     pcbs[pID] = NULL;
 
+    // Release pcbManagerLock
+    pcbManagerLock->ReleaseWrite();
+
 }
 
 PCB* PCBManager::GetPCB(int pid) {
-    return pcbs[pid];
+    if (pid < 0 || pid >= maxProcesses) return NULL;
+
+    // Any number of lookups may go on at once
+    pcbManagerLock->AcquireRead();
+    PCB* pcb = pcbs[pid];
+    pcbManagerLock->ReleaseRead();
+
+    return pcb;
 }
\ No newline at end of file
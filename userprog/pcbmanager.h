@@ -6,12 +6,12 @@
 #include "synch.h"
 
 class PCB;
-class Lock;
+class RWLock;
 
 class PCBManager {
 
     public:
-        PCBManager(int maxProcesses);
+        PCBManager(int numProcesses);
         ~PCBManager();
 
         PCB* AllocatePCB();
@@ -19,10 +19,12 @@ class PCBManager {
         PCB* GetPCB(int pid);
 
     private:
+        int maxProcesses;
         BitMap* bitmap;
         PCB** pcbs;
-        // Need a lock here
-        Lock* pcbManagerLock;
+        // Lookups far outnumber allocations, so GetPCB only takes
+        // the lock for reading
+        RWLock* pcbManagerLock;
 
 };
 
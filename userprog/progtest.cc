@@ -30,13 +30,17 @@ StartProcess(char *filename)
 	printf("Unable to open file %s\n", filename);
 	return;
     }
-    space = new AddrSpace(executable);    
+    space = new AddrSpace(executable, filename);
     currentThread->space = space;
+    currentThread->pcb = pcbManager->AllocatePCB();
+    currentThread->pcb->thread = currentThread;
 
     delete executable;			// close file
 
+    scheduler->ClaimUserRegisters();	// save whatever program was
+					// using the registers
     space->InitRegisters();		// set the initial register values
-    space->RestoreState();		// load page table register
+    scheduler->LoadSpace(space);	// load page table register
 
     machine->Run();			// jump to the user progam
     ASSERT(FALSE);			// machine->Run never returns;
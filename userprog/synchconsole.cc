@@ -0,0 +1,140 @@
+// synchconsole.cc 
+//	Routines to synchronously access the console.  The console is an
+//	asynchronous device (requests return immediately, and an
+//	interrupt happens later on).  This is a layer on top of the
+//	console providing a synchronous interface (requests wait until
+//	the request completes).
+//
+//	Use a semaphore to synchronize the interrupt handlers with the
+//	pending requests.  And, because the console can only handle one
+//	character at a time in each direction, use a lock apiece for
+//	reading and writing.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "synchconsole.h"
+
+//----------------------------------------------------------------------
+// ConsoleReadAvail, ConsoleWriteDone
+// 	Console interrupt handlers.  Need these to be C routines, because 
+//	C++ can't handle pointers to member functions.
+//----------------------------------------------------------------------
+
+static void
+ConsoleReadAvail(int arg)
+{
+    SynchConsole *console = (SynchConsole *)arg;
+
+    console->ReadAvail();
+}
+
+static void
+ConsoleWriteDone(int arg)
+{
+    SynchConsole *console = (SynchConsole *)arg;
+
+    console->WriteDone();
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::SynchConsole
+// 	Initialize the synchronous interface to the console, in turn
+//	initializing the console.
+//
+//	"readFile" -- UNIX file simulating the keyboard (NULL -> use stdin)
+//	"writeFile" -- UNIX file simulating the display (NULL -> use stdout)
+//----------------------------------------------------------------------
+
+SynchConsole::SynchConsole(char *readFile, char *writeFile)
+{
+    readAvail = new Semaphore("console read avail", 0);
+    writeDone = new Semaphore("console write done", 0);
+    readLock = new Lock("console read lock");
+    writeLock = new Lock("console write lock");
+    console = new Console(readFile, writeFile, ConsoleReadAvail,
+				ConsoleWriteDone, (int) this);
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::~SynchConsole
+// 	De-allocate data structures needed for the synchronous console
+//	abstraction.
+//----------------------------------------------------------------------
+
+SynchConsole::~SynchConsole()
+{
+    delete console;
+    delete readLock;
+    delete writeLock;
+    delete readAvail;
+    delete writeDone;
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::GetChar
+// 	Wait for a character to be typed, and return it.
+//----------------------------------------------------------------------
+
+char
+SynchConsole::GetChar()
+{
+    char ch;
+
+    readLock->Acquire();		// only one reader at a time
+    readAvail->P();			// wait for a character to arrive
+    ch = console->GetChar();
+    readLock->Release();
+    return ch;
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::PutChar
+// 	Write a character to the display, and wait for it to go out.
+//----------------------------------------------------------------------
+
+void
+SynchConsole::PutChar(char ch)
+{
+    writeLock->Acquire();		// only one writer at a time
+    console->PutChar(ch);
+    writeDone->P();			// wait for the write to finish
+    writeLock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::Write
+// 	Write "numBytes" characters from "from" to the display.  Other
+//	writers have to wait until the whole run is out.
+//----------------------------------------------------------------------
+
+void
+SynchConsole::Write(char *from, int numBytes)
+{
+    writeLock->Acquire();
+    for (int i = 0; i < numBytes; i++) {
+	console->PutChar(from[i]);
+	writeDone->P();
+    }
+    writeLock->Release();
+}
+
+//----------------------------------------------------------------------
+// SynchConsole::ReadAvail, SynchConsole::WriteDone
+// 	Console interrupt handlers.  Wake up the thread that is waiting
+//	for the console.
+//----------------------------------------------------------------------
+
+void
+SynchConsole::ReadAvail()
+{
+    readAvail->V();
+}
+
+void
+SynchConsole::WriteDone()
+{
+    writeDone->V();
+}
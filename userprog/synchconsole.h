@@ -0,0 +1,51 @@
+// synchconsole.h 
+//	Data structures to export a synchronous interface to the console
+//	device, for user programs reading ConsoleInput and writing
+//	ConsoleOutput.
+//
+//	The console device is asynchronous: a request returns right away,
+//	and an interrupt handler is called when a character arrives or
+//	has been written.  This layer makes the calling thread wait for
+//	the interrupt, and makes sure only one thread at a time is
+//	reading, and one at a time is writing.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SYNCHCONSOLE_H
+#define SYNCHCONSOLE_H
+
+#include "copyright.h"
+#include "console.h"
+#include "synch.h"
+
+// The following class defines a "synchronous" console.
+
+class SynchConsole {
+  public:
+    SynchConsole(char *readFile, char *writeFile);
+				// Initialize the console device; NULL
+				// means stdin/stdout
+    ~SynchConsole();		// De-allocate the console
+
+    char GetChar();		// Wait for a character to arrive, and
+				// return it
+    void PutChar(char ch);	// Write a character, and wait for it
+				// to be written
+    void Write(char *from, int numBytes);
+				// Write a run of characters, without
+				// letting other writers interleave
+
+    void ReadAvail();		// Called by the interrupt handlers,
+    void WriteDone();		// to wake up the waiting thread
+
+  private:
+    Console *console;		// the hardware console
+    Semaphore *readAvail;	// to wait for a character to arrive
+    Semaphore *writeDone;	// to wait for a character to be written
+    Lock *readLock;		// only one reader at a time
+    Lock *writeLock;		// only one writer at a time
+};
+
+#endif // SYNCHCONSOLE_H
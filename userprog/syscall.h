@@ -30,6 +30,7 @@
 #define SC_Fork		9
 #define SC_Yield	10
 #define SC_Kill     11
+#define SC_JoinAny	12
 
 #ifndef IN_ASM
 
@@ -64,6 +65,12 @@ SpaceId Exec(char *name);
  * Return the exit status.
  */
 int Join(SpaceId id); 	
+
+/* Only return once some child of this program has finished, and
+ * return its id; -1 if there are no children left.  If "status" isn't
+ * null, the child's exit status is stored there.
+ */
+SpaceId JoinAny(int *status);
  
 
 /* File system operations: Create, Open, Read, Write, Close
@@ -0,0 +1,186 @@
+// textcache.cc 
+//	Routines to share code pages among the address spaces running
+//	the same program.  See textcache.h.
+//
+//	A program's entry goes away once none of its frames are cached.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "textcache.h"
+
+//----------------------------------------------------------------------
+// TextCache::TextCache
+// 	Initialize an empty cache.
+//----------------------------------------------------------------------
+
+TextCache::TextCache()
+{
+    for (int i = 0; i < MaxTextEntries; i++)
+	entries[i].fileName = NULL;
+    for (int i = 0; i < NumPhysPages; i++)
+	frameEntry[i] = NULL;
+}
+
+//----------------------------------------------------------------------
+// TextCache::~TextCache
+// 	De-allocate the cache.  Nachos is halting, so the frames are
+//	simply left alone.
+//----------------------------------------------------------------------
+
+TextCache::~TextCache()
+{
+    for (int i = 0; i < MaxTextEntries; i++)
+	if (entries[i].fileName != NULL) {
+	    delete [] entries[i].fileName;
+	    delete [] entries[i].frames;
+	}
+}
+
+//----------------------------------------------------------------------
+// TextCache::IsTextPage
+// 	Return TRUE if virtual page "vpn" of a program with header
+//	"noffH" lies entirely within the code segment.
+//----------------------------------------------------------------------
+
+bool
+TextCache::IsTextPage(NoffHeader *noffH, unsigned int vpn)
+{
+    int start = vpn * PageSize;
+
+    return (noffH->code.size > 0) && (start >= noffH->code.virtualAddr)
+		&& (start + PageSize
+			<= noffH->code.virtualAddr + noffH->code.size);
+}
+
+//----------------------------------------------------------------------
+// TextCache::Find
+// 	Return the entry for the executable "fileName", with header
+//	"noffH", or NULL if none of its code is cached.
+//----------------------------------------------------------------------
+
+TextEntry *
+TextCache::Find(char *fileName, NoffHeader *noffH)
+{
+    for (int i = 0; i < MaxTextEntries; i++)
+	if ((entries[i].fileName != NULL)
+		&& !strcmp(entries[i].fileName, fileName)
+		&& !memcmp(&entries[i].noffH, noffH, sizeof(NoffHeader)))
+	    return &entries[i];
+    return NULL;
+}
+
+//----------------------------------------------------------------------
+// TextCache::Lookup
+// 	Return the frame holding code page "vpn" of the executable
+//	"fileName", or -1 if it isn't cached.  The caller adds its own
+//	reference to the frame if it maps it.
+//----------------------------------------------------------------------
+
+int
+TextCache::Lookup(char *fileName, NoffHeader *noffH, unsigned int vpn)
+{
+    TextEntry *entry = Find(fileName, noffH);
+
+    if ((entry == NULL) || (vpn >= (unsigned) entry->numPages))
+	return -1;
+    return entry->frames[vpn];
+}
+
+//----------------------------------------------------------------------
+// TextCache::Insert
+// 	Remember that "frame" holds code page "vpn" of the executable
+//	"fileName", just loaded, and take a reference to it.  If the
+//	cache is full of other programs, the page simply isn't cached.
+//----------------------------------------------------------------------
+
+void
+TextCache::Insert(char *fileName, NoffHeader *noffH, unsigned int vpn,
+								int frame)
+{
+    TextEntry *entry = Find(fileName, noffH);
+
+    ASSERT(IsTextPage(noffH, vpn));
+    if (entry == NULL) {
+	for (int i = 0; (i < MaxTextEntries) && (entry == NULL); i++)
+	    if (entries[i].fileName == NULL)
+		entry = &entries[i];
+	if (entry == NULL)
+	    return;
+	entry->fileName = new char[strlen(fileName) + 1];
+	strcpy(entry->fileName, fileName);
+	entry->noffH = *noffH;
+	entry->numPages = (noffH->code.virtualAddr + noffH->code.size)
+								/ PageSize;
+	entry->frames = new int[entry->numPages];
+	for (int i = 0; i < entry->numPages; i++)
+	    entry->frames[i] = -1;
+	entry->numFrames = 0;
+    }
+    if (entry->frames[vpn] != -1)		// someone beat us to it
+	return;
+
+    DEBUG('a', "Caching code page %d of %s in frame %d\n", vpn, fileName,
+								frame);
+    mm->SharePage(frame);
+    entry->frames[vpn] = frame;
+    entry->numFrames++;
+    frameEntry[frame] = entry;
+    frameVpn[frame] = vpn;
+}
+
+//----------------------------------------------------------------------
+// TextCache::Holds
+// 	Return TRUE if "frame" is one of the cached code frames.
+//----------------------------------------------------------------------
+
+bool
+TextCache::Holds(int frame)
+{
+    return frameEntry[frame] != NULL;
+}
+
+//----------------------------------------------------------------------
+// TextCache::Forget
+// 	Stop caching "frame", and drop the cache's reference to it.  The
+//	frame is freed if no address space is mapping it.
+//----------------------------------------------------------------------
+
+void
+TextCache::Forget(int frame)
+{
+    TextEntry *entry = frameEntry[frame];
+
+    ASSERT(entry != NULL);
+    entry->frames[frameVpn[frame]] = -1;
+    frameEntry[frame] = NULL;
+    mm->DeallocatePage(frame);
+    if (--entry->numFrames == 0) {
+	delete [] entry->fileName;
+	delete [] entry->frames;
+	entry->fileName = NULL;
+    }
+}
+
+//----------------------------------------------------------------------
+// TextCache::ReclaimIdle
+// 	Free a cached frame that only the cache is holding on to, to
+//	make room when memory is short.
+//
+// Returns:
+//	FALSE if every cached frame is in use.
+//----------------------------------------------------------------------
+
+bool
+TextCache::ReclaimIdle()
+{
+    for (int i = 0; i < NumPhysPages; i++)
+	if ((frameEntry[i] != NULL) && (mm->GetRefCount(i) == 1)) {
+	    Forget(i);
+	    return TRUE;
+	}
+    return FALSE;
+}
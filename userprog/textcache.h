@@ -0,0 +1,82 @@
+// textcache.h 
+//	Data structures to share the code segment of a program among
+//	every address space running it.
+//
+//	The first process to run a program loads its code pages as usual,
+//	and the frames are remembered here.  Later processes running the
+//	same executable map those frames instead of reading the code in
+//	again.  Shared code pages are read-only and copy-on-write, so a
+//	program that does write its code gets a private copy.
+//
+//	The cache holds its own reference to each frame (see MemoryManager),
+//	so the code stays in memory between runs.  Frames that nobody else
+//	is using are given back when memory runs short.
+//
+//	Only pages that lie entirely within the code segment are shared;
+//	a page that also holds initialized data is private.
+//
+//	All of these routines must be called with mmLock held.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TEXTCACHE_H
+#define TEXTCACHE_H
+
+#include "copyright.h"
+#include "machine.h"
+#include "noff.h"
+
+#define MaxTextEntries	8		// programs cached at once
+
+// The following class records the code frames of one program.
+
+class TextEntry {
+  public:
+    char *fileName;		// the executable, or NULL if the entry
+				// is free
+    NoffHeader noffH;		// its header, so a rebuilt program with
+				// the same name isn't confused with it
+    int numPages;		// virtual pages covered by "frames"
+    int *frames;		// frame holding each code page, or -1
+    int numFrames;		// how many of them are cached
+};
+
+// The following class defines the shared code page cache.
+
+class TextCache {
+  public:
+    TextCache();			// Initialize an empty cache
+    ~TextCache();
+
+    static bool IsTextPage(NoffHeader *noffH, unsigned int vpn);
+					// Does the page hold nothing but
+					// code?
+
+    int Lookup(char *fileName, NoffHeader *noffH, unsigned int vpn);
+					// Frame holding a code page of a
+					// program, or -1
+    void Insert(char *fileName, NoffHeader *noffH, unsigned int vpn,
+								int frame);
+					// Remember a freshly loaded code
+					// page
+
+    bool Holds(int frame);		// Is the frame cached?
+    void Forget(int frame);		// Drop the cache's reference to a
+					// frame
+    bool ReclaimIdle();			// Free one cached frame that no
+					// address space is mapping; FALSE
+					// if there are none
+
+  private:
+    TextEntry *Find(char *fileName, NoffHeader *noffH);
+					// Entry for a program, or NULL
+
+    TextEntry entries[MaxTextEntries];
+    TextEntry *frameEntry[NumPhysPages]; // entry caching each frame,
+					// or NULL
+    int frameVpn[NumPhysPages];		// and the virtual page it holds
+};
+
+#endif // TEXTCACHE_H
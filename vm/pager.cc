@@ -0,0 +1,326 @@
+// pager.cc 
+//	Routines to bring the pages of user programs into memory on
+//	demand, and to choose pages to evict when memory is full.
+//
+//	Frames come from the MemoryManager, under mmLock, which also
+//	keeps two threads from faulting in the same page at once.  The
+//	coremap records, for each frame, which address space and virtual
+//	page it holds, so that a victim's page table entry can be found.
+//
+//	A frame shared copy-on-write by several processes (a code page,
+//	or a page of zeros) is never chosen as a victim, since there is
+//	no one page table entry to invalidate.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "pager.h"
+#include "addrspace.h"
+
+//----------------------------------------------------------------------
+// Pager::Pager
+// 	Initialize the pager: every frame empty, and no swap file yet.
+//
+//	"replacementPolicy" -- how to choose a page to evict
+//----------------------------------------------------------------------
+
+Pager::Pager(ReplacementPolicy replacementPolicy)
+{
+    policy = replacementPolicy;
+    for (int i = 0; i < NumPhysPages; i++) {
+	coremap[i].space = NULL;
+	coremap[i].vpn = 0;
+	coremap[i].loadedAt = 0;
+	coremap[i].age = 0;
+    }
+    loadCount = 0;
+    clockHand = 0;
+    swapFull = FALSE;
+    swap = new SwapSpace("SWAP");
+}
+
+Pager::~Pager()
+{
+    delete swap;
+}
+
+//----------------------------------------------------------------------
+// Pager::HandlePageFault
+// 	Handle a PageFaultException raised by the current user program.
+//	The faulting instruction is retried once we return.
+//
+//	With a TLB, the exception usually just means the page isn't in
+//	the TLB; it is paged in only if it isn't in memory either.
+//
+//	"virtAddr" -- the address that faulted
+//----------------------------------------------------------------------
+
+bool
+Pager::HandlePageFault(int virtAddr)
+{
+    AddrSpace *space = currentThread->space;
+    unsigned int vpn = (unsigned) virtAddr / PageSize;
+    bool loaded;
+
+    DEBUG('a', "Page fault at 0x%x, virtual page %d\n", virtAddr, vpn);
+    if (vpn >= space->GetNumPages())
+	return FALSE;
+    mmLock->Acquire();
+    loaded = Load(space, vpn);
+#ifdef USE_TLB
+    if (loaded)				// still holding mmLock, so the
+	tlbManager->Refill(space, vpn);	// page can't have been evicted
+#endif
+    mmLock->Release();
+    return loaded;
+}
+
+//----------------------------------------------------------------------
+// Pager::PageIn
+// 	Make virtual page "vpn" of "space" resident, if it isn't already.
+//
+//	"space" -- the address space
+//	"vpn" -- the virtual page
+//----------------------------------------------------------------------
+
+bool
+Pager::PageIn(AddrSpace *space, unsigned int vpn)
+{
+    bool loaded;
+
+    ASSERT(vpn < space->GetNumPages());
+    mmLock->Acquire();
+    loaded = Load(space, vpn);
+    mmLock->Release();
+    return loaded;
+}
+
+//----------------------------------------------------------------------
+// Pager::Load
+// 	The guts of PageIn, for callers already holding mmLock.
+//----------------------------------------------------------------------
+
+bool
+Pager::Load(AddrSpace *space, unsigned int vpn)
+{
+    int frame;
+
+    if (!space->GetPageTable()[vpn].valid) {	// nobody beat us to it
+	if (!space->ShareText(vpn)) {
+	    if ((frame = AllocateFrame(space, vpn)) == -1)
+		return FALSE;
+	    space->LoadPage(vpn, frame);
+	}
+	stats->numPageFaults++;
+    }
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Pager::AllocateFrame
+// 	Find a frame for virtual page "vpn" of "space", and record the
+//	new owner.  If there are no free frames, cached code that nobody
+//	is running is given up first, and only then is a page evicted.
+//	The caller fills the frame and maps the page.
+//
+// Returns:
+//	The frame, or -1 if memory is full of pages that can't be evicted.
+//----------------------------------------------------------------------
+
+int
+Pager::AllocateFrame(AddrSpace *space, unsigned int vpn)
+{
+    int frame;
+
+    ASSERT(mmLock->isHeldByCurrentThread());
+    if ((frame = mm->AllocatePage()) == -1) {
+	if (!textCache->ReclaimIdle() && !Evict())
+	    return -1;
+	frame = mm->AllocatePage();
+	ASSERT(frame != -1);
+    }
+    ClaimFrame(frame, space, vpn);
+    coremap[frame].loadedAt = loadCount++;
+    coremap[frame].age = 0;
+    return frame;
+}
+
+//----------------------------------------------------------------------
+// Pager::ClaimFrame
+// 	Record that "frame" holds virtual page "vpn" of "space".  Used
+//	when a frame is allocated, and when the last process sharing a
+//	copy-on-write frame takes it over.
+//----------------------------------------------------------------------
+
+void
+Pager::ClaimFrame(int frame, AddrSpace *space, unsigned int vpn)
+{
+    coremap[frame].space = space;
+    coremap[frame].vpn = vpn;
+}
+
+//----------------------------------------------------------------------
+// Pager::ReleaseFrame
+// 	Called before "space" drops its reference to "frame".  If "space"
+//	was the owner, the frame is no longer anybody's to evict; if
+//	another process still shares it, it stays in memory until that
+//	process claims it (by writing it) or exits.
+//----------------------------------------------------------------------
+
+void
+Pager::ReleaseFrame(int frame, AddrSpace *space)
+{
+    if (coremap[frame].space == space)
+	coremap[frame].space = NULL;
+}
+
+//----------------------------------------------------------------------
+// Pager::Evictable
+// 	Return TRUE if the page in "frame" may be evicted: it belongs to
+//	exactly one address space (and perhaps the code page cache), and,
+//	if it has been modified, there is somewhere in swap to put it.
+//----------------------------------------------------------------------
+
+bool
+Pager::Evictable(int frame)
+{
+    int refs = mm->GetRefCount(frame);
+
+    if (textCache->Holds(frame))
+	refs--;
+    if ((coremap[frame].space == NULL) || (refs != 1))
+	return FALSE;
+    return !swapFull || !coremap[frame].space->NeedsSwapSlot(coremap[frame].vpn);
+}
+
+//----------------------------------------------------------------------
+// Pager::EntryFor
+// 	Return the page table entry that maps "frame".
+//----------------------------------------------------------------------
+
+TranslationEntry *
+Pager::EntryFor(int frame)
+{
+    return &(coremap[frame].space->GetPageTable()[coremap[frame].vpn]);
+}
+
+//----------------------------------------------------------------------
+// Pager::Evict
+// 	Choose a victim page, by the replacement policy, and take it out
+//	of memory.  The owning address space writes it to swap if it has
+//	been modified; if swap is full, only clean pages are considered.
+//
+// Returns:
+//	FALSE if no page can be evicted.  The faulting process can't go
+//	on, but the rest of the system can.
+//----------------------------------------------------------------------
+
+bool
+Pager::Evict()
+{
+    int victim = -1;
+
+#ifdef USE_TLB
+    tlbManager->Flush();		// bring the use and dirty bits in
+					// the page tables up to date
+#endif
+    swapFull = swap->IsFull();
+    switch (policy) {
+      case FIFOReplacement:	victim = ChooseFIFO(); break;
+      case ClockReplacement:	victim = ChooseClock(); break;
+      case LRUReplacement:	victim = ChooseLRU(); break;
+      default:			ASSERT(FALSE);
+    }
+    if ((victim == -1)
+	    || !coremap[victim].space->ReserveSwapSlot(coremap[victim].vpn))
+	return FALSE;
+
+    DEBUG('a', "Evicting virtual page %d from frame %d\n",
+					coremap[victim].vpn, victim);
+    stats->numPageEvictions++;
+    coremap[victim].space->EvictPage(coremap[victim].vpn);
+    coremap[victim].space = NULL;
+    if (textCache->Holds(victim))
+	textCache->Forget(victim);
+    mm->DeallocatePage(victim);
+
+    // the victim's mapping is gone, and the policies may have cleared
+    // use bits, so cached translations are stale
+    machine->FlushTranslationCache();
+    return TRUE;
+}
+
+//----------------------------------------------------------------------
+// Pager::ChooseFIFO
+// 	Pick the evictable page that has been in memory the longest.
+//----------------------------------------------------------------------
+
+int
+Pager::ChooseFIFO()
+{
+    int victim = -1;
+
+    for (int i = 0; i < NumPhysPages; i++)
+	if (Evictable(i) && ((victim == -1)
+			|| (coremap[i].loadedAt < coremap[victim].loadedAt)))
+	    victim = i;
+    return victim;
+}
+
+//----------------------------------------------------------------------
+// Pager::ChooseClock
+// 	Sweep the frames in order, giving each page whose use bit is set
+//	a second chance (and clearing the bit), until one is found that
+//	hasn't been used since the last sweep.  Two full sweeps are
+//	enough to find one, if there is an evictable page at all.
+//----------------------------------------------------------------------
+
+int
+Pager::ChooseClock()
+{
+    TranslationEntry *entry;
+    int frame;
+
+    for (int i = 0; i < 2 * NumPhysPages; i++) {
+	frame = clockHand;
+	clockHand = (clockHand + 1) % NumPhysPages;
+	if (!Evictable(frame))
+	    continue;
+	entry = EntryFor(frame);
+	if (!entry->use)
+	    return frame;
+	entry->use = FALSE;		// second chance
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// Pager::ChooseLRU
+// 	Approximate least-recently-used by aging: each time a victim is
+//	needed, shift every page's use bit into the top of its age, and
+//	clear the use bit.  The page with the smallest age has gone
+//	unused the longest; ties go to the page loaded first.
+//----------------------------------------------------------------------
+
+int
+Pager::ChooseLRU()
+{
+    TranslationEntry *entry;
+    int victim = -1;
+
+    for (int i = 0; i < NumPhysPages; i++) {
+	if (!Evictable(i))
+	    continue;
+	entry = EntryFor(i);
+	coremap[i].age = (coremap[i].age >> 1) | (entry->use ? 0x80 : 0);
+	entry->use = FALSE;
+	if ((victim == -1) || (coremap[i].age < coremap[victim].age)
+		|| ((coremap[i].age == coremap[victim].age)
+			&& (coremap[i].loadedAt < coremap[victim].loadedAt)))
+	    victim = i;
+    }
+    return victim;
+}
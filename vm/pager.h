@@ -0,0 +1,99 @@
+// pager.h 
+//	Data structures for demand paging.
+//
+//	A user address space starts out with no pages in memory.  The
+//	first reference to a page raises a PageFaultException, and the
+//	pager finds the page a frame and has the address space fill it in
+//	(see AddrSpace::LoadPage).
+//
+//	When there are no free frames, the pager evicts a page, chosen by
+//	one of several replacement policies.  A modified page is written
+//	to the swap space first; a clean one can simply be read in again
+//	from wherever it came from.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef PAGER_H
+#define PAGER_H
+
+#include "copyright.h"
+#include "machine.h"
+#include "swapspace.h"
+
+class AddrSpace;
+
+// Page replacement policies
+enum ReplacementPolicy { FIFOReplacement,	// oldest page in memory
+			 ClockReplacement,	// second chance, by use bit
+			 LRUReplacement		// least recently used, as
+						// approximated by aging the
+						// use bits
+};
+
+// The following class records which virtual page is in each frame.
+
+class FrameInfo {
+  public:
+    AddrSpace *space;		// address space owning the frame, or NULL
+				// if it is free (or shared, and its
+				// owner has gone away)
+    unsigned int vpn;		// the virtual page in the frame
+    int loadedAt;		// when it was brought in (a sequence number)
+    unsigned char age;		// recent history of its use bit, newest in
+				// the top bit (for LRUReplacement)
+};
+
+// The following class defines the demand pager.
+
+class Pager {
+  public:
+    Pager(ReplacementPolicy replacementPolicy);
+				// Initialize the pager and swap space
+    ~Pager();
+
+    bool HandlePageFault(int virtAddr);
+				// Bring in the page of the current
+				// address space holding "virtAddr"
+    bool PageIn(AddrSpace *space, unsigned int vpn);
+				// Bring in virtual page "vpn" of "space"
+
+				// Both return FALSE if the address is
+				// outside the address space, or no frame
+				// can be found
+
+// The following must be called with mmLock held.
+
+    int AllocateFrame(AddrSpace *space, unsigned int vpn);
+				// Find a frame for a page, evicting some
+				// other page if need be; -1 if none can be
+    void ClaimFrame(int frame, AddrSpace *space, unsigned int vpn);
+				// Record a new owner for a shared frame
+    void ReleaseFrame(int frame, AddrSpace *space);
+				// "space" is giving up its mapping of
+				// "frame"
+
+    SwapSpace *swap;		// where modified pages go when evicted
+
+  private:
+    bool Load(AddrSpace *space, unsigned int vpn);
+				// PageIn, with mmLock already held
+    bool Evict();		// Make a free frame; FALSE if no page
+				// can be evicted
+    bool Evictable(int frame);	// Is the frame's page a candidate?
+    TranslationEntry *EntryFor(int frame);
+				// The page table entry mapping a frame
+    int ChooseFIFO();		// Pick a victim frame, by policy
+    int ChooseClock();
+    int ChooseLRU();
+
+    ReplacementPolicy policy;	// how victims are chosen
+    FrameInfo coremap[NumPhysPages]; // what is in each frame
+    int loadCount;		// sequence number for FrameInfo::loadedAt
+    int clockHand;		// next frame for ClockReplacement to look at
+    bool swapFull;		// no slot for another modified page, as of
+				// the start of this Evict
+};
+
+#endif // PAGER_H
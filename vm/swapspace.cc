@@ -0,0 +1,124 @@
+// swapspace.cc 
+//	Routines to manage the swap file, where modified user pages go
+//	when they are evicted from memory.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "swapspace.h"
+
+//----------------------------------------------------------------------
+// SwapSpace::SwapSpace
+// 	Initialize the swap space.  The file itself is created by the
+//	first Allocate.
+//
+//	"name" -- the name of the swap file
+//----------------------------------------------------------------------
+
+SwapSpace::SwapSpace(const char *name)
+{
+    fileName = name;
+    file = NULL;
+    slots = NULL;
+    numSlots = 0;
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::~SwapSpace
+// 	Close the swap file and throw it away, if it was ever created.
+//----------------------------------------------------------------------
+
+SwapSpace::~SwapSpace()
+{
+    if (slots == NULL)
+	return;
+    delete file;
+    delete slots;
+    fileSystem->Remove(fileName);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::CreateFile
+// 	Create the swap file, big enough for NumSwapPages pages if there
+//	is room on the disk, or else as many as there is room for (maybe
+//	none), and mark every slot free.  A swap file left over from an
+//	earlier run is thrown away first; its contents are of no use.
+//----------------------------------------------------------------------
+
+void
+SwapSpace::CreateFile()
+{
+    (void) fileSystem->Remove(fileName);
+    for (numSlots = NumSwapPages; numSlots > 0; numSlots /= 2)
+	if (fileSystem->Create(fileName, numSlots * PageSize))
+	    break;
+    if (numSlots > 0) {
+	file = fileSystem->Open(fileName);
+	ASSERT(file != NULL);
+    }
+    DEBUG('a', "Created swap file \"%s\" with %d slots\n", fileName,
+	  numSlots);
+    slots = new BitMap(numSlots > 0 ? numSlots : 1);
+    if (numSlots == 0)
+	slots->Mark(0);			// nothing to hand out
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::Allocate, SwapSpace::Free
+// 	Find a free slot, or give one back.  Allocate returns -1 if the
+//	swap file is full.
+//----------------------------------------------------------------------
+
+int
+SwapSpace::Allocate()
+{
+    if (slots == NULL)
+	CreateFile();
+    return slots->Find();
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::IsFull
+// 	Return TRUE if every slot is in use, so that a modified page
+//	can't be written out.
+//----------------------------------------------------------------------
+
+bool
+SwapSpace::IsFull()
+{
+    if (slots == NULL)
+	CreateFile();
+    return slots->NumClear() == 0;
+}
+
+void
+SwapSpace::Free(int slot)
+{
+    ASSERT(slots->Test(slot));
+    slots->Clear(slot);
+}
+
+//----------------------------------------------------------------------
+// SwapSpace::ReadPage, SwapSpace::WritePage
+// 	Move one page between a slot and memory.
+//
+//	"slot" -- the slot in the swap file
+//	"into"/"from" -- the page, usually a frame in mainMemory
+//----------------------------------------------------------------------
+
+void
+SwapSpace::ReadPage(int slot, char *into)
+{
+    ASSERT(slots->Test(slot));
+    file->ReadAt(into, PageSize, slot * PageSize);
+}
+
+void
+SwapSpace::WritePage(int slot, char *from)
+{
+    ASSERT(slots->Test(slot));
+    file->WriteAt(from, PageSize, slot * PageSize);
+}
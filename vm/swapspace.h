@@ -0,0 +1,60 @@
+// swapspace.h 
+//	Data structures for the backing store of paged-out user pages.
+//
+//	The swap space is a Nachos file, divided into page-sized slots.
+//	A page that has been modified is written to a slot when it is
+//	evicted, and read back from there the next time it is touched.
+//
+//	The file isn't created until the first page needs a slot, so that
+//	running Nachos for other reasons (formatting the disk, say) doesn't
+//	need room for it.  With the real file system, the swap file can be
+//	no bigger than the largest file it can hold; if even that doesn't
+//	fit on the disk, it is made as big as will fit.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef SWAPSPACE_H
+#define SWAPSPACE_H
+
+#include "copyright.h"
+#include "filesys.h"
+#include "bitmap.h"
+
+#ifdef FILESYS
+#include "filehdr.h"
+#define NumSwapPages	(MaxFileSize / PageSize) // slots in the swap file:
+					// as many as a file can hold
+#else
+#define NumSwapPages	1024		// slots in the swap file
+#endif
+
+// The following class defines the swap space.
+
+class SwapSpace {
+  public:
+    SwapSpace(const char *name);	// Initialize; the swap file "name"
+					// is created when first needed
+    ~SwapSpace();			// Close and remove it
+
+    int Allocate();			// Find a free slot; -1 if full
+    bool IsFull();			// Would Allocate return -1?
+    void Free(int slot);		// Give a slot back
+
+    void ReadPage(int slot, char *into);
+    void WritePage(int slot, char *from);
+					// Move one page between a slot
+					// and memory
+
+  private:
+    const char *fileName;		// the swap file
+    OpenFile *file;			// NULL until it is created
+    BitMap *slots;			// which slots are in use
+    int numSlots;			// how many pages the file holds
+
+    void CreateFile();			// replace any old swap file with
+					// a new one, as big as will fit
+};
+
+#endif // SWAPSPACE_H
@@ -0,0 +1,159 @@
+// tlbmanager.cc 
+//	Routines to refill the software-loaded TLB from the page table.
+//
+//	Every change to the TLB also flushes the simulator's translation
+//	cache, which only holds translations that are in the TLB.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#include "copyright.h"
+#include "system.h"
+#include "tlbmanager.h"
+#include "addrspace.h"
+
+//----------------------------------------------------------------------
+// TLBManager::TLBManager
+// 	Initialize the TLB refill handler.  The machine starts out with
+//	every TLB entry invalid.
+//
+//	"replacementPolicy" -- how to choose an entry to replace
+//----------------------------------------------------------------------
+
+TLBManager::TLBManager(TLBPolicy replacementPolicy)
+{
+    policy = replacementPolicy;
+    owner = NULL;
+    nextSlot = 0;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::Refill
+// 	Handle a TLB miss: copy the page table entry for virtual page
+//	"vpn" of "space" into the TLB, replacing an entry if the TLB is
+//	full.  The page must be in memory.
+//
+//	"space" -- the address space running on the machine
+//	"vpn" -- the virtual page that missed
+//----------------------------------------------------------------------
+
+void
+TLBManager::Refill(AddrSpace *space, unsigned int vpn)
+{
+    TranslationEntry *entry = &(space->GetPageTable()[vpn]);
+    int slot;
+
+    ASSERT(entry->valid);
+    if (owner != space)			// left over from another space
+	Flush();
+    owner = space;
+
+    slot = ChooseSlot();
+    WriteBack(slot);
+    DEBUG('a', "TLB entry %d <- virtual page %d, frame %d\n", slot, vpn,
+						entry->physicalPage);
+    machine->tlb[slot] = *entry;
+    machine->tlb[slot].use = FALSE;
+    machine->tlb[slot].dirty = FALSE;
+    machine->FlushTranslationCache();
+}
+
+//----------------------------------------------------------------------
+// TLBManager::Invalidate
+// 	Drop the TLB entry for virtual page "vpn" of "space", if it has
+//	one.  Call this before changing the page's page table entry.
+//----------------------------------------------------------------------
+
+void
+TLBManager::Invalidate(AddrSpace *space, unsigned int vpn)
+{
+    if (owner != space)
+	return;
+    for (int i = 0; i < machine->tlbSize; i++)
+	if (machine->tlb[i].valid && (machine->tlb[i].virtualPage == vpn)) {
+	    WriteBack(i);
+	    machine->tlb[i].valid = FALSE;
+	    machine->FlushTranslationCache();
+	}
+}
+
+//----------------------------------------------------------------------
+// TLBManager::Flush
+// 	Invalidate the whole TLB, bringing the owner's page table up to
+//	date first.  Called on a context switch, and whenever the kernel
+//	is about to look at or change many page table entries at once.
+//----------------------------------------------------------------------
+
+void
+TLBManager::Flush()
+{
+    for (int i = 0; i < machine->tlbSize; i++) {
+	WriteBack(i);
+	machine->tlb[i].valid = FALSE;
+    }
+    owner = NULL;
+    nextSlot = 0;			// refills start again from entry 0
+    machine->FlushTranslationCache();
+}
+
+//----------------------------------------------------------------------
+// TLBManager::WriteBack
+// 	Merge the use and dirty bits of TLB entry "slot" into the owner's
+//	page table.  The bits are only ever set by the hardware, so this
+//	never clears a bit the kernel has set in the page table.
+//----------------------------------------------------------------------
+
+void
+TLBManager::WriteBack(int slot)
+{
+    TranslationEntry *entry = &(machine->tlb[slot]);
+    TranslationEntry *pte;
+
+    if (!entry->valid)
+	return;
+    pte = &(owner->GetPageTable()[entry->virtualPage]);
+    pte->use = pte->use || entry->use;
+    pte->dirty = pte->dirty || entry->dirty;
+}
+
+//----------------------------------------------------------------------
+// TLBManager::ChooseSlot
+// 	Return a TLB entry to load: an invalid one if there is one,
+//	otherwise one chosen by the replacement policy.
+//----------------------------------------------------------------------
+
+int
+TLBManager::ChooseSlot()
+{
+    TranslationEntry *tlb = machine->tlb;
+    int size = machine->tlbSize;
+    int slot;
+
+    for (slot = 0; slot < size; slot++)
+	if (!tlb[slot].valid)
+	    return slot;
+
+    switch (policy) {
+      case TLBRandomReplacement:
+	return Random() % size;
+
+      case TLBClockReplacement:
+	// entries only get their use bit back when they are next used
+	// after the translation cache is flushed, which every refill does
+	for (;;) {
+	    slot = nextSlot;
+	    nextSlot = (nextSlot + 1) % size;
+	    if (!tlb[slot].use)
+		return slot;
+	    WriteBack(slot);
+	    tlb[slot].use = FALSE;	// second chance
+	}
+
+      case TLBFIFOReplacement:
+      default:
+	slot = nextSlot;
+	nextSlot = (nextSlot + 1) % size;
+	return slot;
+    }
+}
@@ -0,0 +1,61 @@
+// tlbmanager.h 
+//	Data structures for managing the software-loaded TLB.
+//
+//	With USE_TLB, the simulated MIPS translates through a small TLB
+//	rather than the page table.  A reference to a page not in the TLB
+//	raises a PageFaultException, and the kernel loads the page's entry
+//	from the current address space's page table (paging the page in
+//	first, if need be) and retries the instruction.
+//
+//	The TLB only ever holds entries for one address space.  The use
+//	and dirty bits the hardware sets in a TLB entry are copied back to
+//	the page table when the entry is replaced, and whenever the kernel
+//	needs the page table to be up to date.
+//
+// Copyright (c) 1992-1993 The Regents of the University of California.
+// All rights reserved.  See copyright.h for copyright notice and limitation 
+// of liability and disclaimer of warranty provisions.
+
+#ifndef TLBMANAGER_H
+#define TLBMANAGER_H
+
+#include "copyright.h"
+#include "machine.h"
+
+class AddrSpace;
+
+// TLB replacement policies
+enum TLBPolicy { TLBFIFOReplacement,	// oldest entry
+		 TLBRandomReplacement,	// any entry
+		 TLBClockReplacement	// second chance, by use bit
+};
+
+// The following class defines the kernel's TLB refill handler.
+
+class TLBManager {
+  public:
+    TLBManager(TLBPolicy replacementPolicy);	// Initialize, with an empty TLB
+
+    void Refill(AddrSpace *space, unsigned int vpn);
+					// Load the page table entry for
+					// resident page "vpn" of "space"
+    void Invalidate(AddrSpace *space, unsigned int vpn);
+					// Drop the TLB entry for a page,
+					// if there is one, before its page
+					// table entry is changed
+    void Flush();			// Drop every entry, copying use
+					// and dirty bits back first
+
+  private:
+    int ChooseSlot();			// Pick an entry to replace
+    void WriteBack(int slot);		// Copy an entry's use and dirty
+					// bits back to the page table
+
+    TLBPolicy policy;			// how entries are replaced
+    AddrSpace *owner;			// the address space whose pages
+					// are in the TLB, or NULL
+    int nextSlot;			// next entry to replace, for FIFO
+					// and clock replacement
+};
+
+#endif // TLBMANAGER_H